@@ -2,17 +2,26 @@
 
 #include "cmatrix.h"
 #include "gnm.h"
+#include "gtcontrol.h"
 #include "ipa.h"
 #include "nfgame.h"
+#include "threadpool.h"
 
 #include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <memory>
 #include <new>
 #include <vector>
 #include <exception>
 
+// The limits of gtcontrol.h, with the flag that cancels the call.
+struct gametracer_control {
+    gtcontrol ctl;
+    std::atomic<int> cancel;
+};
+
 namespace {
 
 struct GameSizes {
@@ -51,6 +60,55 @@ static bool compute_sizes(int num_players, const int* actions, GameSizes& out) {
     return true;
 }
 
+// Solver buffers kept between calls on the same thread, so repeated solves
+// of games of one shape do not reallocate them.  They are made on first use
+// and held, at the size of the largest game solved, until the thread exits
+// or calls gametracer_release_workspaces.
+static thread_local std::unique_ptr<gnmworkspace> gnm_ws;
+static thread_local std::unique_ptr<ipaworkspace> ipa_ws;
+
+// Set while a GNM call on this thread is using gnm_ws.  gnm_stream's
+// callback may call GNM again; that inner call then works in a workspace
+// of its own, as the outer one still holds references into gnm_ws.  A
+// release asked for meanwhile is done once the outer call is over.
+static thread_local bool gnm_ws_busy = false;
+static thread_local bool gnm_ws_release = false;
+
+// The workspace for one GNM call: the thread's if it is free, else a
+// temporary one.
+class GnmWorkspaceLease {
+public:
+    GnmWorkspaceLease() : held(!gnm_ws_busy) {
+        if (held) {
+            if (!gnm_ws) gnm_ws.reset(new gnmworkspace);
+            gnm_ws_busy = true;
+        } else {
+            local.reset(new gnmworkspace);
+        }
+    }
+    ~GnmWorkspaceLease() {
+        if (!held) return;
+        gnm_ws_busy = false;
+        if (gnm_ws_release) {
+            gnm_ws.reset();
+            gnm_ws_release = false;
+        }
+    }
+    gnmworkspace& get() { return held ? *gnm_ws : *local; }
+
+private:
+    GnmWorkspaceLease(const GnmWorkspaceLease&);
+    GnmWorkspaceLease& operator=(const GnmWorkspaceLease&);
+
+    bool held;
+    std::unique_ptr<gnmworkspace> local;
+};
+
+static ipaworkspace& ipa_workspace() {
+    if (!ipa_ws) ipa_ws.reset(new ipaworkspace);
+    return *ipa_ws;
+}
+
 static void cleanup_eq(cvector** Eq, int numEq) {
     if (!Eq) return;
     for (int k = 0; k < numEq; ++k) {
@@ -59,15 +117,60 @@ static void cleanup_eq(cvector** Eq, int numEq) {
     std::free(Eq);
 }
 
-} // namespace
+// Moves the found equilibria of Eq into a malloc'd buffer at *answers
+// (NULL if there are none) and frees Eq; returns found, or a shim error.
+static int take_answers(cvector**& Eq, int found, int M, double** answers) {
+    if (found <= 0) {
+        // Upstream should not return <0, but treat it as internal error if it happens.
+        cleanup_eq(Eq, 0);
+        Eq = nullptr;
+        *answers = nullptr;
+        return found == 0 ? 0 : -3;
+    }
 
-extern "C" {
+    // Allocate contiguous output buffer: found * M doubles
+    size_t total = static_cast<size_t>(found) * static_cast<size_t>(M);
+    double* buf = static_cast<double*>(std::malloc(total * sizeof(double)));
+    if (!buf) {
+        cleanup_eq(Eq, found);
+        Eq = nullptr;
+        return -2;
+    }
 
-GAMETRACER_API void GAMETRACER_CALL gametracer_free(void* p) {
-    std::free(p);
+    for (int k = 0; k < found; ++k) {
+        std::memcpy(buf + static_cast<size_t>(k) * static_cast<size_t>(M),
+                    Eq[k]->values(),
+                    static_cast<size_t>(M) * sizeof(double));
+    }
+
+    cleanup_eq(Eq, found);
+    Eq = nullptr;
+
+    *answers = buf; // ownership transferred to caller
+    return found;
 }
 
-GAMETRACER_API int GAMETRACER_CALL ipa(
+// Passes GNM's equilibria on to a gametracer_eq_callback.
+struct StreamSink {
+    gametracer_eq_callback callback;
+    void* ctx;
+};
+
+static int stream_eq(void* arg, const cvector& e, int k) {
+    StreamSink* sink = static_cast<StreamSink*>(arg);
+    return sink->callback(sink->ctx, e.values(), e.getm(), k) != 0;
+}
+
+// Frees a checkpoint blob handed out by run_gnm, if there is one.
+static void drop_blob(void** blob, size_t* len) {
+    if (!blob) return;
+    std::free(*blob);
+    *blob = nullptr;
+    *len = 0;
+}
+
+// ipa, within the limits of ctrl if it is set
+static int run_ipa(
     int num_players,
     const int* actions,
     const double* payoffs,
@@ -75,7 +178,8 @@ GAMETRACER_API int GAMETRACER_CALL ipa(
     double* zh,
     double alpha,
     double fuzz,
-    double* ans
+    double* ans,
+    gametracer_control* ctrl
 ) {
     if (actions == nullptr || payoffs == nullptr || g == nullptr || zh == nullptr || ans == nullptr)
         return -1;
@@ -101,7 +205,10 @@ GAMETRACER_API int GAMETRACER_CALL ipa(
 
         cvector ansvec(sz.M);
 
-        int ret = IPA(A, gvec, zhvec, alpha, fuzz, ansvec);
+        ipaopts opts;
+        if (ctrl) opts.control = &ctrl->ctl;
+
+        int ret = IPA(A, gvec, zhvec, alpha, fuzz, ansvec, ipa_workspace(), opts);
 
         // Copy back outputs
         std::memcpy(zh, zhvec.values(), static_cast<size_t>(sz.M) * sizeof(double));
@@ -115,7 +222,11 @@ GAMETRACER_API int GAMETRACER_CALL ipa(
     }
 }
 
-GAMETRACER_API int GAMETRACER_CALL gnm(
+// gnm, storing each equilibrium within tol of another only once if tol > 0,
+// and within the limits of ctrl if it is set.  If resume is set, the path
+// carries on from that checkpoint blob; if checkpoint is set, it receives
+// a malloc'd blob of the path where it last entered a cell.
+static int run_gnm(
     int num_players,
     const int* actions,
     const double* payoffs,
@@ -127,12 +238,22 @@ GAMETRACER_API int GAMETRACER_CALL gnm(
     int lnmmax,
     double lambdamin,
     int wobble,
-    double threshold
+    double threshold,
+    double tol,
+    gametracer_control* ctrl,
+    const void* resume,
+    size_t resume_len,
+    void** checkpoint,
+    size_t* checkpoint_len
 ) {
     if (answers) *answers = nullptr;
+    if (checkpoint) *checkpoint = nullptr;
+    if (checkpoint_len) *checkpoint_len = 0;
 
     if (actions == nullptr || payoffs == nullptr || g == nullptr || answers == nullptr)
         return -1;
+    if ((checkpoint == nullptr) != (checkpoint_len == nullptr))
+        return -1;
 
     GameSizes sz;
     if (!compute_sizes(num_players, actions, sz))
@@ -140,7 +261,6 @@ GAMETRACER_API int GAMETRACER_CALL gnm(
 
     cvector** Eq = nullptr;
     int found = 0;          // hoisted for exception-safe cleanup
-    double* buf = nullptr;  // in case we allocate and then throw
 
     try {
         std::vector<int> acts(static_cast<size_t>(sz.N));
@@ -155,49 +275,331 @@ GAMETRACER_API int GAMETRACER_CALL gnm(
         cvector gvec(sz.M);
         std::memcpy(gvec.values(), g, static_cast<size_t>(sz.M) * sizeof(double));
 
-        found = GNM(A, gvec, Eq, steps, fuzz, lnmfreq, lnmmax, lambdamin, wobble, threshold);
+        gnmopts opts;
+        opts.unique = tol;
+        if (ctrl) opts.control = &ctrl->ctl;
 
-        if (found == 0) {
-            cleanup_eq(Eq, 0);
-            *answers = nullptr;
-            return 0;
+        gnmcheckpoint from, ck;
+        if (resume) {
+            if (!from.load(static_cast<const char*>(resume), resume_len))
+                return -1;
+            opts.resume = &from;
         }
-        if (found < 0) {
-            // Upstream should not return <0, but treat it as internal error if it happens.
-            cleanup_eq(Eq, 0);
-            *answers = nullptr;
-            return -3;
+        if (checkpoint) opts.checkpoint = &ck;
+
+        GnmWorkspaceLease ws;
+        found = GNM(A, gvec, Eq, steps, fuzz, lnmfreq, lnmmax, lambdamin, wobble, threshold, ws.get(), opts);
+
+        if (checkpoint && ck.valid()) {
+            std::vector<char> blob;
+            ck.save(blob);
+            void* buf = std::malloc(blob.size());
+            if (!buf) {
+                cleanup_eq(Eq, found);
+                Eq = nullptr;
+                return -2;
+            }
+            std::memcpy(buf, blob.data(), blob.size());
+            *checkpoint = buf;
+            *checkpoint_len = blob.size();
         }
 
-        // Allocate contiguous output buffer: found * M doubles
-        size_t total = static_cast<size_t>(found) * static_cast<size_t>(sz.M);
-        buf = static_cast<double*>(std::malloc(total * sizeof(double)));
-        if (!buf) {
-            cleanup_eq(Eq, found);
-            Eq = nullptr;
-            return -2;
-        }
+        int ret = take_answers(Eq, found, sz.M, answers);
+        if (ret < 0)
+            drop_blob(checkpoint, checkpoint_len);
+        return ret;
 
-        for (int k = 0; k < found; ++k) {
-            std::memcpy(buf + static_cast<size_t>(k) * static_cast<size_t>(sz.M),
-                        Eq[k]->values(),
+    } catch (const std::bad_alloc&) {
+        cleanup_eq(Eq, (found > 0) ? found : 0);
+        *answers = nullptr;
+        drop_blob(checkpoint, checkpoint_len);
+        return -2;
+    } catch (...) {
+        cleanup_eq(Eq, (found > 0) ? found : 0);
+        *answers = nullptr;
+        drop_blob(checkpoint, checkpoint_len);
+        return -3;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+GAMETRACER_API void GAMETRACER_CALL gametracer_free(void* p) {
+    std::free(p);
+}
+
+GAMETRACER_API int GAMETRACER_CALL gametracer_set_num_threads(int n) {
+    gt_set_num_threads(n < 0 ? 0 : n);
+    return gt_get_num_threads();
+}
+
+GAMETRACER_API void GAMETRACER_CALL gametracer_release_workspaces(void) {
+    if (gnm_ws_busy)
+        gnm_ws_release = true; // called from a gnm_stream callback
+    else
+        gnm_ws.reset();
+    ipa_ws.reset();
+}
+
+GAMETRACER_API gametracer_control* GAMETRACER_CALL gametracer_control_new(
+    double deadline,
+    long long max_steps,
+    long long max_support_changes,
+    long long max_iterations
+) {
+    gametracer_control* ctrl = new (std::nothrow) gametracer_control;
+    if (!ctrl) return nullptr;
+    ctrl->cancel = 0;
+    ctrl->ctl.deadline = deadline > 0.0 ? deadline : 0.0;
+    ctrl->ctl.maxsteps = max_steps > 0 ? static_cast<long>(max_steps) : 0;
+    ctrl->ctl.maxsupport = max_support_changes > 0 ? static_cast<long>(max_support_changes) : 0;
+    ctrl->ctl.maxiters = max_iterations > 0 ? static_cast<long>(max_iterations) : 0;
+    ctrl->ctl.cancel = &ctrl->cancel;
+    return ctrl;
+}
+
+GAMETRACER_API void GAMETRACER_CALL gametracer_control_cancel(gametracer_control* ctrl) {
+    if (ctrl) ctrl->cancel = 1;
+}
+
+GAMETRACER_API void GAMETRACER_CALL gametracer_control_reset(gametracer_control* ctrl) {
+    if (ctrl) ctrl->cancel = 0;
+}
+
+GAMETRACER_API int GAMETRACER_CALL gametracer_control_status(const gametracer_control* ctrl) {
+    return ctrl ? static_cast<int>(ctrl->ctl.status) : 0;
+}
+
+GAMETRACER_API void GAMETRACER_CALL gametracer_control_free(gametracer_control* ctrl) {
+    delete ctrl;
+}
+
+GAMETRACER_API int GAMETRACER_CALL ipa(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    double* zh,
+    double alpha,
+    double fuzz,
+    double* ans
+) {
+    return run_ipa(num_players, actions, payoffs, g, zh, alpha, fuzz, ans, nullptr);
+}
+
+GAMETRACER_API int GAMETRACER_CALL ipa_control(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    double* zh,
+    double alpha,
+    double fuzz,
+    double* ans,
+    gametracer_control* ctrl
+) {
+    return run_ipa(num_players, actions, payoffs, g, zh, alpha, fuzz, ans, ctrl);
+}
+
+GAMETRACER_API int GAMETRACER_CALL gnm(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    double** answers,
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold
+) {
+    return run_gnm(num_players, actions, payoffs, g, answers, steps, fuzz,
+                   lnmfreq, lnmmax, lambdamin, wobble, threshold, 0.0, nullptr,
+                   nullptr, 0, nullptr, nullptr);
+}
+
+GAMETRACER_API int GAMETRACER_CALL gnm_unique(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    double** answers,
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol
+) {
+    return run_gnm(num_players, actions, payoffs, g, answers, steps, fuzz,
+                   lnmfreq, lnmmax, lambdamin, wobble, threshold, tol > 0.0 ? tol : 0.0, nullptr,
+                   nullptr, 0, nullptr, nullptr);
+}
+
+GAMETRACER_API int GAMETRACER_CALL gnm_control(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    double** answers,
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol,
+    gametracer_control* ctrl
+) {
+    return run_gnm(num_players, actions, payoffs, g, answers, steps, fuzz,
+                   lnmfreq, lnmmax, lambdamin, wobble, threshold, tol > 0.0 ? tol : 0.0, ctrl,
+                   nullptr, 0, nullptr, nullptr);
+}
+
+GAMETRACER_API int GAMETRACER_CALL gnm_resumable(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    double** answers,
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol,
+    gametracer_control* ctrl,
+    const void* resume,
+    size_t resume_len,
+    void** checkpoint,
+    size_t* checkpoint_len
+) {
+    return run_gnm(num_players, actions, payoffs, g, answers, steps, fuzz,
+                   lnmfreq, lnmmax, lambdamin, wobble, threshold, tol > 0.0 ? tol : 0.0, ctrl,
+                   resume, resume_len, checkpoint, checkpoint_len);
+}
+
+GAMETRACER_API int GAMETRACER_CALL gnm_stream(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    const double* g,
+    gametracer_eq_callback callback,
+    void* ctx,
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol
+) {
+    if (actions == nullptr || payoffs == nullptr || g == nullptr || callback == nullptr)
+        return -1;
+
+    GameSizes sz;
+    if (!compute_sizes(num_players, actions, sz))
+        return -1;
+
+    try {
+        std::vector<int> acts(static_cast<size_t>(sz.N));
+        for (int p = 0; p < sz.N; ++p) acts[p] = actions[p];
+
+        cvector payvec(sz.payoff_len);
+        std::memcpy(payvec.values(), payoffs, static_cast<size_t>(sz.payoff_len) * sizeof(double));
+
+        nfgame A(sz.N, acts.data(), payvec);
+
+        // Treat g as immutable: copy into local cvector before calling upstream GNM (which mutates g)
+        cvector gvec(sz.M);
+        std::memcpy(gvec.values(), g, static_cast<size_t>(sz.M) * sizeof(double));
+
+        gnmopts opts;
+        opts.unique = tol > 0.0 ? tol : 0.0;
+
+        StreamSink sink = { callback, ctx };
+        GnmWorkspaceLease ws;
+        int found = GNM(A, gvec, stream_eq, &sink, steps, fuzz, lnmfreq, lnmmax, lambdamin, wobble, threshold, ws.get(), opts);
+        return found >= 0 ? found : -3;
+
+    } catch (const std::bad_alloc&) {
+        return -2;
+    } catch (...) {
+        return -3;
+    }
+}
+
+GAMETRACER_API int GAMETRACER_CALL gnm_rays(
+    int num_players,
+    const int* actions,
+    const double* payoffs,
+    int num_rays,
+    const double* g,
+    double** answers,
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    int first,
+    double deadline
+) {
+    if (answers) *answers = nullptr;
+
+    if (actions == nullptr || payoffs == nullptr || g == nullptr || answers == nullptr || num_rays <= 0)
+        return -1;
+
+    GameSizes sz;
+    if (!compute_sizes(num_players, actions, sz))
+        return -1;
+    if (static_cast<size_t>(num_rays) > static_cast<size_t>(INT_MAX) / static_cast<size_t>(sz.M))
+        return -1;
+
+    cvector** Eq = nullptr;
+    int found = 0;          // hoisted for exception-safe cleanup
+
+    try {
+        std::vector<int> acts(static_cast<size_t>(sz.N));
+        for (int p = 0; p < sz.N; ++p) acts[p] = actions[p];
+
+        cvector payvec(sz.payoff_len);
+        std::memcpy(payvec.values(), payoffs, static_cast<size_t>(sz.payoff_len) * sizeof(double));
+
+        nfgame A(sz.N, acts.data(), payvec);
+
+        // Copies of the rays, which GNM scales
+        std::vector<cvector> gvecs(static_cast<size_t>(num_rays));
+        for (int r = 0; r < num_rays; ++r) {
+            gvecs[r].resize(sz.M);
+            std::memcpy(gvecs[r].values(), g + static_cast<size_t>(r) * static_cast<size_t>(sz.M),
                         static_cast<size_t>(sz.M) * sizeof(double));
         }
 
-        cleanup_eq(Eq, found);
-        Eq = nullptr;
+        gnmraysopts ropts;
+        ropts.first = first != 0;
+        ropts.deadline = deadline;
+
+        found = GNMrays(A, gvecs.data(), num_rays, Eq, steps, fuzz, lnmfreq, lnmmax, lambdamin, wobble, threshold, gnmopts(), ropts);
 
-        *answers = buf;
-        buf = nullptr; // ownership transferred to caller
-        return found;
+        return take_answers(Eq, found, sz.M, answers);
 
     } catch (const std::bad_alloc&) {
-        if (buf) std::free(buf);
         cleanup_eq(Eq, (found > 0) ? found : 0);
         *answers = nullptr;
         return -2;
     } catch (...) {
-        if (buf) std::free(buf);
         cleanup_eq(Eq, (found > 0) ? found : 0);
         *answers = nullptr;
         return -3;
@@ -1,6 +1,8 @@
 #ifndef GAMETRACER_C_API_H
 #define GAMETRACER_C_API_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +42,28 @@ Flattened action vectors g/zh/ans: length M (player-concatenated)
 /* Free buffers allocated by the library (e.g. gnm() answers). Safe on NULL. */
 GAMETRACER_API void GAMETRACER_CALL gametracer_free(void* p);
 
+/*
+gametracer_set_num_threads:
+- Sets how many threads large matrix factorizations may use, counting the
+  calling thread; 0 (the default) means one per hardware thread.
+  Factorizations below the size threshold always run on the caller.
+- Must not be called while another thread is inside ipa() or gnm().
+Return value: the thread count now in effect.
+*/
+GAMETRACER_API int GAMETRACER_CALL gametracer_set_num_threads(int n);
+
+/*
+gametracer_release_workspaces:
+- Each thread that calls ipa, ipa_control, gnm, gnm_unique, gnm_control,
+  gnm_resumable or gnm_stream keeps that solver's working buffers, sized
+  for the largest game it has solved (O(M^2) doubles), so that later
+  calls reuse them.  They are freed when the thread exits, or by this
+  call, which frees those of the calling thread.  A later call makes
+  them afresh.  Called from a gnm_stream callback, it frees the GNM
+  buffers once that gnm_stream returns.
+*/
+GAMETRACER_API void GAMETRACER_CALL gametracer_release_workspaces(void);
+
 /*
 ipa:
 - Inputs: game (num_players, actions, payoffs), g (length M), alpha, fuzz
@@ -94,6 +118,200 @@ GAMETRACER_API int GAMETRACER_CALL gnm(
     double threshold
 );
 
+/*
+gnm_unique:
+- As gnm, but an equilibrium within tol (in every entry) of one the path
+  has already found is not returned again; tol <= 0 returns them all, as gnm
+Return value and *answers: as for gnm
+*/
+GAMETRACER_API int GAMETRACER_CALL gnm_unique(
+    int num_players,
+    const int* actions,           /* length num_players */
+    const double* payoffs,        /* length num_players * prod(actions) */
+    const double* g,              /* length M (treated as immutable by shim) */
+    double** answers,             /* output: malloc'd; free with gametracer_free */
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol
+);
+
+/*
+gametracer_eq_callback:
+- Receives each equilibrium as gnm_stream finds it: eq has length M and
+  is only valid during the call; k counts the equilibria so far, from 1
+- Return nonzero to go on tracing the path, 0 to stop there
+*/
+typedef int (GAMETRACER_CALL *gametracer_eq_callback)(void* ctx, const double* eq, int M, int k);
+
+/*
+gnm_stream:
+- As gnm_unique, but rather than collecting the equilibria, calls
+  callback(ctx, ...) with each as soon as it is found, on the calling
+  thread; the callback can end the trace early (e.g. after the first)
+- The callback may call back into this API, including gnm_stream itself;
+  a GNM call made from it works in buffers of its own, which are freed
+  when it returns
+Return value:
+- >=0: number of equilibria passed to the callback
+- <0 : as for gnm
+*/
+GAMETRACER_API int GAMETRACER_CALL gnm_stream(
+    int num_players,
+    const int* actions,           /* length num_players */
+    const double* payoffs,        /* length num_players * prod(actions) */
+    const double* g,              /* length M (treated as immutable by shim) */
+    gametracer_eq_callback callback,
+    void* ctx,                    /* passed through to callback */
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol
+);
+
+/*
+gnm_rays:
+- As gnm, but follows num_rays perturbation rays at once on the thread pool
+  (see gametracer_set_num_threads), each from its own ray:
+  g has length num_rays * M, ray r being g[r*M .. r*M + M-1]
+- The equilibria of all the paths are merged, in ray order; one within
+  1e-6 (in every entry) of one already kept is dropped
+- first: if nonzero, the rays still running stop once one finds an equilibrium
+- deadline: if > 0, the rays still running stop after this many seconds
+- Rays stopped early contribute the equilibria they found before stopping
+Return value and *answers: as for gnm
+*/
+GAMETRACER_API int GAMETRACER_CALL gnm_rays(
+    int num_players,
+    const int* actions,           /* length num_players */
+    const double* payoffs,        /* length num_players * prod(actions) */
+    int num_rays,
+    const double* g,              /* length num_rays * M (treated as immutable) */
+    double** answers,             /* output: malloc'd; free with gametracer_free */
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    int first,
+    double deadline
+);
+
+/*
+gametracer_control:
+- Limits on an ipa_control or gnm_control call, and a way to cancel it
+- gametracer_control_new: deadline in seconds of wall-clock time, and the
+  most GNM path steps, GNM support changes and IPA iterations; 0 (or less)
+  for no limit.  Returns NULL on allocation failure.
+- gametracer_control_cancel: stops the call using ctrl at its next step;
+  safe to call from any thread.  The flag stays set until
+  gametracer_control_reset.
+- gametracer_control_status: how the last call using ctrl ended:
+    0 ran to its end
+    1 stopped on the deadline or a count
+    2 stopped by gametracer_control_cancel
+- A control may be used by one call at a time, and again afterwards;
+  the counts and the clock start afresh with each call.
+*/
+typedef struct gametracer_control gametracer_control;
+
+GAMETRACER_API gametracer_control* GAMETRACER_CALL gametracer_control_new(
+    double deadline,
+    long long max_steps,
+    long long max_support_changes,
+    long long max_iterations
+);
+GAMETRACER_API void GAMETRACER_CALL gametracer_control_cancel(gametracer_control* ctrl);
+GAMETRACER_API void GAMETRACER_CALL gametracer_control_reset(gametracer_control* ctrl);
+GAMETRACER_API int GAMETRACER_CALL gametracer_control_status(const gametracer_control* ctrl);
+/* Safe on NULL. */
+GAMETRACER_API void GAMETRACER_CALL gametracer_control_free(gametracer_control* ctrl);
+
+/*
+ipa_control:
+- As ipa, within the limits of ctrl (NULL for none)
+- A call stopped by ctrl returns 0; gametracer_control_status says why
+*/
+GAMETRACER_API int GAMETRACER_CALL ipa_control(
+    int num_players,
+    const int* actions,           /* length num_players */
+    const double* payoffs,        /* length num_players * prod(actions) */
+    const double* g,              /* length M */
+    double* zh,                   /* length M (in/out work buffer) */
+    double alpha,
+    double fuzz,                  /* equilibrium cutoff tolerance */
+    double* ans,                  /* length M (output) */
+    gametracer_control* ctrl
+);
+
+/*
+gnm_control:
+- As gnm_unique, within the limits of ctrl (NULL for none)
+- A call stopped by ctrl returns the equilibria found before it stopped,
+  as gnm does; gametracer_control_status says whether it was stopped
+*/
+GAMETRACER_API int GAMETRACER_CALL gnm_control(
+    int num_players,
+    const int* actions,           /* length num_players */
+    const double* payoffs,        /* length num_players * prod(actions) */
+    const double* g,              /* length M (treated as immutable by shim) */
+    double** answers,             /* output: malloc'd; free with gametracer_free */
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol,
+    gametracer_control* ctrl
+);
+
+/*
+gnm_resumable:
+- As gnm_control, with a path that can be stopped and carried on later
+- If checkpoint is not NULL, *checkpoint receives a malloc'd blob of
+  *checkpoint_len bytes holding the state of the path where it last entered
+  a support cell (NULL if it never did); free it with gametracer_free
+- If resume is not NULL, the path carries on from such a blob, taken on a
+  game of the same shape with the same parameters, instead of starting at g
+  (which must still be given); the equilibria found before the blob was
+  taken are returned again, and a call stopped by ctrl and resumed returns
+  just what one uninterrupted call would have
+- The blob is in the byte order of the machine; a damaged or foreign blob
+  returns -1
+*/
+GAMETRACER_API int GAMETRACER_CALL gnm_resumable(
+    int num_players,
+    const int* actions,           /* length num_players */
+    const double* payoffs,        /* length num_players * prod(actions) */
+    const double* g,              /* length M (treated as immutable by shim) */
+    double** answers,             /* output: malloc'd; free with gametracer_free */
+    int steps,
+    double fuzz,
+    int lnmfreq,
+    int lnmmax,
+    double lambdamin,
+    int wobble,
+    double threshold,
+    double tol,
+    gametracer_control* ctrl,
+    const void* resume,           /* NULL to start afresh */
+    size_t resume_len,
+    void** checkpoint,            /* output: malloc'd; free with gametracer_free */
+    size_t* checkpoint_len
+);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
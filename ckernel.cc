@@ -0,0 +1,626 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ckernel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CK_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef GT_USE_BLAS
+#include <cblas.h>
+#endif
+
+void *ck_malloc(size_t bytes) {
+  void *p;
+  if(bytes == 0)
+    bytes = 64;
+#ifdef _WIN32
+  p = _aligned_malloc(bytes, 64);
+#else
+  if(posix_memalign(&p, 64, bytes) != 0)
+    p = 0;
+#endif
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void ck_free(void *p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+// grow-only per-thread buffer
+struct ckbuffer {
+  double *p;
+  size_t n;
+  ckbuffer() : p(0), n(0) {}
+  ~ckbuffer() { if(p) ck_free(p); }
+  double *get(size_t want) {
+    if(want > n) {
+      if(p) ck_free(p);
+      p = 0;
+      n = 0;
+      p = (double *)ck_malloc(want * sizeof(double));
+      n = want;
+    }
+    return p;
+  }
+};
+
+static thread_local ckbuffer ckwork, ckpackA, ckpackB;
+
+double *ck_workspace(size_t n) {
+  return ckwork.get(n);
+}
+
+// REFERENCE KERNELS
+
+void ck_gemm_ref(int m, int n, int k, double alpha, const double *A, int lda,
+		 const double *B, int ldb, double beta, double *C, int ldc) {
+  int i, j, p;
+  double a, *c;
+  for(i = 0; i < m; i++) {
+    c = C + (size_t)i*ldc;
+    if(beta == 0.0)
+      memset(c, 0, n*sizeof(double));
+    else if(beta != 1.0)
+      for(j = 0; j < n; j++)
+	c[j] *= beta;
+    for(p = 0; p < k; p++) {
+      a = alpha * A[(size_t)i*lda+p];
+      const double *b = B + (size_t)p*ldb;
+      for(j = 0; j < n; j++)
+	c[j] += a * b[j];
+    }
+  }
+}
+
+void ck_sgemm_ref(int m, int n, int k, float alpha, const float *A, int lda,
+		  const float *B, int ldb, float beta, float *C, int ldc) {
+  int i, j, p;
+  float a, *c;
+  for(i = 0; i < m; i++) {
+    c = C + (size_t)i*ldc;
+    if(beta == 0.0f)
+      memset(c, 0, n*sizeof(float));
+    else if(beta != 1.0f)
+      for(j = 0; j < n; j++)
+	c[j] *= beta;
+    for(p = 0; p < k; p++) {
+      a = alpha * A[(size_t)i*lda+p];
+      const float *b = B + (size_t)p*ldb;
+      for(j = 0; j < n; j++)
+	c[j] += a * b[j];
+    }
+  }
+}
+
+void ck_axpy_ref(int n, double a, const double *x, double *y) {
+  for(int i = 0; i < n; i++)
+    y[i] += a * x[i];
+}
+
+void ck_saxpy_ref(int n, float a, const float *x, float *y) {
+  for(int i = 0; i < n; i++)
+    y[i] += a * x[i];
+}
+
+void ck_pivot_ref(int n, double a, double b, double c, const double *x, double *y) {
+  for(int i = 0; i < n; i++)
+    y[i] = (a * y[i] - b * x[i]) * c;
+}
+
+void ck_gemv_ref(int m, int n, const double *A, int lda, const double *x, double *y) {
+  int i, j;
+  double sum;
+  for(i = 0; i < m; i++) {
+    const double *a = A + (size_t)i*lda;
+    sum = 0.0;
+    for(j = 0; j < n; j++)
+      sum += a[j] * x[j];
+    y[i] = sum;
+  }
+}
+
+// BLOCKED GEMM
+// C is computed in MR x NR tiles.  For each KC x NC block of B, B is
+// packed into NR-wide column strips, and each MR-row panel of A into
+// k-major order, so the tile kernel streams through both contiguously.
+
+#define CK_MR 4
+#define CK_KC 256
+#define CK_NC 512
+#define CK_NRMAX 32
+
+// acc (MR x nr, row-major) = Ap * Bp over kc terms.  T is double or
+// float; the packing buffers are sized in doubles, so they hold either.
+template <class T>
+static void gemm_blocked(int m, int n, int k, T alpha, const T *A, int lda,
+			 const T *B, int ldb, T beta, T *C, int ldc,
+			 void (*tile)(int kc, const T *Ap, const T *Bp, T *acc), int nr) {
+  int ic, jc, pc, jr, i, j, p, mr, nc, kc, nrr;
+  T b, *c;
+  T acc[CK_MR*CK_NRMAX];
+  T *Bp = (T *)ckpackB.get((size_t)CK_KC*(CK_NC+CK_NRMAX));
+  T *Ap = (T *)ckpackA.get((size_t)CK_KC*CK_MR);
+
+  for(jc = 0; jc < n; jc += CK_NC) {
+    nc = n - jc < CK_NC ? n - jc : CK_NC;
+    for(pc = 0; pc < k; pc += CK_KC) {
+      kc = k - pc < CK_KC ? k - pc : CK_KC;
+      b = pc == 0 ? beta : 1.0;
+
+      for(jr = 0; jr < nc; jr += nr) {
+	nrr = nc - jr < nr ? nc - jr : nr;
+	T *dst = Bp + (size_t)jr*kc;
+	for(p = 0; p < kc; p++) {
+	  const T *src = B + (size_t)(pc+p)*ldb + jc + jr;
+	  for(j = 0; j < nrr; j++)
+	    dst[j] = src[j];
+	  for(; j < nr; j++)
+	    dst[j] = 0;
+	  dst += nr;
+	}
+      }
+
+      for(ic = 0; ic < m; ic += CK_MR) {
+	mr = m - ic < CK_MR ? m - ic : CK_MR;
+	for(p = 0; p < kc; p++) {
+	  for(i = 0; i < mr; i++)
+	    Ap[p*CK_MR+i] = A[(size_t)(ic+i)*lda + pc + p];
+	  for(; i < CK_MR; i++)
+	    Ap[p*CK_MR+i] = 0;
+	}
+	for(jr = 0; jr < nc; jr += nr) {
+	  nrr = nc - jr < nr ? nc - jr : nr;
+	  tile(kc, Ap, Bp + (size_t)jr*kc, acc);
+	  for(i = 0; i < mr; i++) {
+	    c = C + (size_t)(ic+i)*ldc + jc + jr;
+	    if(b == 0)
+	      for(j = 0; j < nrr; j++)
+		c[j] = alpha * acc[i*nr+j];
+	    else
+	      for(j = 0; j < nrr; j++)
+		c[j] = alpha * acc[i*nr+j] + b * c[j];
+	  }
+	}
+      }
+    }
+  }
+}
+
+#ifdef CK_X86
+
+__attribute__((target("avx2,fma")))
+static void tile_avx2(int kc, const double *Ap, const double *Bp, double *acc) {
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd(),
+    c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd(),
+    c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd(),
+    c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d a, b0, b1;
+  for(int p = 0; p < kc; p++) {
+    b0 = _mm256_loadu_pd(Bp);
+    b1 = _mm256_loadu_pd(Bp+4);
+    a = _mm256_broadcast_sd(Ap);
+    c00 = _mm256_fmadd_pd(a, b0, c00);
+    c01 = _mm256_fmadd_pd(a, b1, c01);
+    a = _mm256_broadcast_sd(Ap+1);
+    c10 = _mm256_fmadd_pd(a, b0, c10);
+    c11 = _mm256_fmadd_pd(a, b1, c11);
+    a = _mm256_broadcast_sd(Ap+2);
+    c20 = _mm256_fmadd_pd(a, b0, c20);
+    c21 = _mm256_fmadd_pd(a, b1, c21);
+    a = _mm256_broadcast_sd(Ap+3);
+    c30 = _mm256_fmadd_pd(a, b0, c30);
+    c31 = _mm256_fmadd_pd(a, b1, c31);
+    Ap += CK_MR;
+    Bp += 8;
+  }
+  _mm256_storeu_pd(acc, c00);    _mm256_storeu_pd(acc+4, c01);
+  _mm256_storeu_pd(acc+8, c10);  _mm256_storeu_pd(acc+12, c11);
+  _mm256_storeu_pd(acc+16, c20); _mm256_storeu_pd(acc+20, c21);
+  _mm256_storeu_pd(acc+24, c30); _mm256_storeu_pd(acc+28, c31);
+}
+
+__attribute__((target("avx512f")))
+static void tile_avx512(int kc, const double *Ap, const double *Bp, double *acc) {
+  __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd(),
+    c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd(),
+    c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd(),
+    c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+  __m512d a, b0, b1;
+  for(int p = 0; p < kc; p++) {
+    b0 = _mm512_loadu_pd(Bp);
+    b1 = _mm512_loadu_pd(Bp+8);
+    a = _mm512_set1_pd(Ap[0]);
+    c00 = _mm512_fmadd_pd(a, b0, c00);
+    c01 = _mm512_fmadd_pd(a, b1, c01);
+    a = _mm512_set1_pd(Ap[1]);
+    c10 = _mm512_fmadd_pd(a, b0, c10);
+    c11 = _mm512_fmadd_pd(a, b1, c11);
+    a = _mm512_set1_pd(Ap[2]);
+    c20 = _mm512_fmadd_pd(a, b0, c20);
+    c21 = _mm512_fmadd_pd(a, b1, c21);
+    a = _mm512_set1_pd(Ap[3]);
+    c30 = _mm512_fmadd_pd(a, b0, c30);
+    c31 = _mm512_fmadd_pd(a, b1, c31);
+    Ap += CK_MR;
+    Bp += 16;
+  }
+  _mm512_storeu_pd(acc, c00);    _mm512_storeu_pd(acc+8, c01);
+  _mm512_storeu_pd(acc+16, c10); _mm512_storeu_pd(acc+24, c11);
+  _mm512_storeu_pd(acc+32, c20); _mm512_storeu_pd(acc+40, c21);
+  _mm512_storeu_pd(acc+48, c30); _mm512_storeu_pd(acc+56, c31);
+}
+
+// single precision tiles: twice the columns per register
+
+__attribute__((target("avx2,fma")))
+static void stile_avx2(int kc, const float *Ap, const float *Bp, float *acc) {
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps(),
+    c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps(),
+    c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps(),
+    c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  __m256 a, b0, b1;
+  for(int p = 0; p < kc; p++) {
+    b0 = _mm256_loadu_ps(Bp);
+    b1 = _mm256_loadu_ps(Bp+8);
+    a = _mm256_broadcast_ss(Ap);
+    c00 = _mm256_fmadd_ps(a, b0, c00);
+    c01 = _mm256_fmadd_ps(a, b1, c01);
+    a = _mm256_broadcast_ss(Ap+1);
+    c10 = _mm256_fmadd_ps(a, b0, c10);
+    c11 = _mm256_fmadd_ps(a, b1, c11);
+    a = _mm256_broadcast_ss(Ap+2);
+    c20 = _mm256_fmadd_ps(a, b0, c20);
+    c21 = _mm256_fmadd_ps(a, b1, c21);
+    a = _mm256_broadcast_ss(Ap+3);
+    c30 = _mm256_fmadd_ps(a, b0, c30);
+    c31 = _mm256_fmadd_ps(a, b1, c31);
+    Ap += CK_MR;
+    Bp += 16;
+  }
+  _mm256_storeu_ps(acc, c00);    _mm256_storeu_ps(acc+8, c01);
+  _mm256_storeu_ps(acc+16, c10); _mm256_storeu_ps(acc+24, c11);
+  _mm256_storeu_ps(acc+32, c20); _mm256_storeu_ps(acc+40, c21);
+  _mm256_storeu_ps(acc+48, c30); _mm256_storeu_ps(acc+56, c31);
+}
+
+__attribute__((target("avx512f")))
+static void stile_avx512(int kc, const float *Ap, const float *Bp, float *acc) {
+  __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps(),
+    c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps(),
+    c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps(),
+    c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+  __m512 a, b0, b1;
+  for(int p = 0; p < kc; p++) {
+    b0 = _mm512_loadu_ps(Bp);
+    b1 = _mm512_loadu_ps(Bp+16);
+    a = _mm512_set1_ps(Ap[0]);
+    c00 = _mm512_fmadd_ps(a, b0, c00);
+    c01 = _mm512_fmadd_ps(a, b1, c01);
+    a = _mm512_set1_ps(Ap[1]);
+    c10 = _mm512_fmadd_ps(a, b0, c10);
+    c11 = _mm512_fmadd_ps(a, b1, c11);
+    a = _mm512_set1_ps(Ap[2]);
+    c20 = _mm512_fmadd_ps(a, b0, c20);
+    c21 = _mm512_fmadd_ps(a, b1, c21);
+    a = _mm512_set1_ps(Ap[3]);
+    c30 = _mm512_fmadd_ps(a, b0, c30);
+    c31 = _mm512_fmadd_ps(a, b1, c31);
+    Ap += CK_MR;
+    Bp += 32;
+  }
+  _mm512_storeu_ps(acc, c00);    _mm512_storeu_ps(acc+16, c01);
+  _mm512_storeu_ps(acc+32, c10); _mm512_storeu_ps(acc+48, c11);
+  _mm512_storeu_ps(acc+64, c20); _mm512_storeu_ps(acc+80, c21);
+  _mm512_storeu_ps(acc+96, c30); _mm512_storeu_ps(acc+112, c31);
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(int n, double a, const double *x, double *y) {
+  int i;
+  __m256d va = _mm256_set1_pd(a);
+  for(i = 0; i+4 <= n; i += 4)
+    _mm256_storeu_pd(y+i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i)));
+  for(; i < n; i++)
+    y[i] += a * x[i];
+}
+
+__attribute__((target("avx512f")))
+static void axpy_avx512(int n, double a, const double *x, double *y) {
+  int i;
+  __m512d va = _mm512_set1_pd(a);
+  for(i = 0; i+8 <= n; i += 8)
+    _mm512_storeu_pd(y+i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x+i), _mm512_loadu_pd(y+i)));
+  if(i < n) {
+    __mmask8 k = (__mmask8)((1u << (n-i)) - 1);
+    _mm512_mask_storeu_pd(y+i, k, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(k, x+i),
+						   _mm512_maskz_loadu_pd(k, y+i)));
+  }
+}
+
+__attribute__((target("avx2,fma")))
+static void saxpy_avx2(int n, float a, const float *x, float *y) {
+  int i;
+  __m256 va = _mm256_set1_ps(a);
+  for(i = 0; i+8 <= n; i += 8)
+    _mm256_storeu_ps(y+i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x+i), _mm256_loadu_ps(y+i)));
+  for(; i < n; i++)
+    y[i] += a * x[i];
+}
+
+__attribute__((target("avx512f")))
+static void saxpy_avx512(int n, float a, const float *x, float *y) {
+  int i;
+  __m512 va = _mm512_set1_ps(a);
+  for(i = 0; i+16 <= n; i += 16)
+    _mm512_storeu_ps(y+i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x+i), _mm512_loadu_ps(y+i)));
+  if(i < n) {
+    __mmask16 k = (__mmask16)((1u << (n-i)) - 1);
+    _mm512_mask_storeu_ps(y+i, k, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(k, x+i),
+						  _mm512_maskz_loadu_ps(k, y+i)));
+  }
+}
+
+__attribute__((target("avx2,fma")))
+static void pivot_avx2(int n, double a, double b, double c, const double *x, double *y) {
+  int i;
+  __m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b), vc = _mm256_set1_pd(c);
+  for(i = 0; i+4 <= n; i += 4)
+    _mm256_storeu_pd(y+i, _mm256_mul_pd(_mm256_fmsub_pd(va, _mm256_loadu_pd(y+i),
+							_mm256_mul_pd(vb, _mm256_loadu_pd(x+i))), vc));
+  for(; i < n; i++)
+    y[i] = (a * y[i] - b * x[i]) * c;
+}
+
+__attribute__((target("avx512f")))
+static void pivot_avx512(int n, double a, double b, double c, const double *x, double *y) {
+  int i;
+  __m512d va = _mm512_set1_pd(a), vb = _mm512_set1_pd(b), vc = _mm512_set1_pd(c);
+  for(i = 0; i+8 <= n; i += 8)
+    _mm512_storeu_pd(y+i, _mm512_mul_pd(_mm512_fmsub_pd(va, _mm512_loadu_pd(y+i),
+							_mm512_mul_pd(vb, _mm512_loadu_pd(x+i))), vc));
+  if(i < n) {
+    __mmask8 k = (__mmask8)((1u << (n-i)) - 1);
+    __m512d v = _mm512_fmsub_pd(va, _mm512_maskz_loadu_pd(k, y+i),
+				_mm512_mul_pd(vb, _mm512_maskz_loadu_pd(k, x+i)));
+    _mm512_mask_storeu_pd(y+i, k, _mm512_mul_pd(v, vc));
+  }
+}
+
+// four rows at a time, so each load of x is shared
+__attribute__((target("avx2,fma")))
+static void gemv_avx2(int m, int n, const double *A, int lda, const double *x, double *y) {
+  int i, j;
+  for(i = 0; i+4 <= m; i += 4) {
+    const double *a0 = A + (size_t)i*lda, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(),
+      s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd(), v;
+    for(j = 0; j+4 <= n; j += 4) {
+      v = _mm256_loadu_pd(x+j);
+      s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a0+j), v, s0);
+      s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a1+j), v, s1);
+      s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a2+j), v, s2);
+      s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a3+j), v, s3);
+    }
+    // horizontal sums of s0..s3 into one vector
+    __m256d h01 = _mm256_hadd_pd(s0, s1), h23 = _mm256_hadd_pd(s2, s3);
+    __m256d r = _mm256_add_pd(_mm256_permute2f128_pd(h01, h23, 0x20),
+			      _mm256_permute2f128_pd(h01, h23, 0x31));
+    double t[4];
+    _mm256_storeu_pd(t, r);
+    for(; j < n; j++) {
+      t[0] += a0[j] * x[j];
+      t[1] += a1[j] * x[j];
+      t[2] += a2[j] * x[j];
+      t[3] += a3[j] * x[j];
+    }
+    y[i] = t[0]; y[i+1] = t[1]; y[i+2] = t[2]; y[i+3] = t[3];
+  }
+  if(i < m)
+    ck_gemv_ref(m-i, n, A + (size_t)i*lda, lda, x, y+i);
+}
+
+__attribute__((target("avx512f")))
+static void gemv_avx512(int m, int n, const double *A, int lda, const double *x, double *y) {
+  int i, j;
+  for(i = 0; i+4 <= m; i += 4) {
+    const double *a0 = A + (size_t)i*lda, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(),
+      s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd(), v;
+    for(j = 0; j+8 <= n; j += 8) {
+      v = _mm512_loadu_pd(x+j);
+      s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a0+j), v, s0);
+      s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a1+j), v, s1);
+      s2 = _mm512_fmadd_pd(_mm512_loadu_pd(a2+j), v, s2);
+      s3 = _mm512_fmadd_pd(_mm512_loadu_pd(a3+j), v, s3);
+    }
+    double t0 = _mm512_reduce_add_pd(s0), t1 = _mm512_reduce_add_pd(s1),
+      t2 = _mm512_reduce_add_pd(s2), t3 = _mm512_reduce_add_pd(s3);
+    for(; j < n; j++) {
+      t0 += a0[j] * x[j];
+      t1 += a1[j] * x[j];
+      t2 += a2[j] * x[j];
+      t3 += a3[j] * x[j];
+    }
+    y[i] = t0; y[i+1] = t1; y[i+2] = t2; y[i+3] = t3;
+  }
+  if(i < m)
+    ck_gemv_ref(m-i, n, A + (size_t)i*lda, lda, x, y+i);
+}
+
+static int ck_cpu_isa() {
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    return CK_ISA_AVX512;
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return CK_ISA_AVX2;
+  return CK_ISA_SCALAR;
+}
+
+#else
+
+static int ck_cpu_isa() {
+  return CK_ISA_SCALAR;
+}
+
+#endif
+
+static int ck_cpu = ck_cpu_isa();
+static int ck_current = ck_cpu;
+
+int ck_isa() {
+  return ck_current;
+}
+
+int ck_set_isa(int isa) {
+  ck_current = isa < ck_cpu ? isa : ck_cpu;
+  if(ck_current < CK_ISA_SCALAR)
+    ck_current = CK_ISA_SCALAR;
+  return ck_current;
+}
+
+// below these sizes packing costs more than it saves
+#define CK_GEMM_MIN 4096
+#define CK_GEMV_MIN 8
+
+void ck_gemm(int m, int n, int k, double alpha, const double *A, int lda,
+	     const double *B, int ldb, double beta, double *C, int ldc) {
+  if(m <= 0 || n <= 0)
+    return;
+#ifdef GT_USE_BLAS
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k,
+	      alpha, A, lda, B, ldb, beta, C, ldc);
+  return;
+#endif
+#ifdef CK_X86
+  if(k > 0 && (double)m*n*k >= CK_GEMM_MIN) {
+    if(ck_current == CK_ISA_AVX512) {
+      gemm_blocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, tile_avx512, 16);
+      return;
+    }
+    if(ck_current == CK_ISA_AVX2) {
+      gemm_blocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, tile_avx2, 8);
+      return;
+    }
+  }
+#endif
+  ck_gemm_ref(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void ck_sgemm(int m, int n, int k, float alpha, const float *A, int lda,
+	      const float *B, int ldb, float beta, float *C, int ldc) {
+  if(m <= 0 || n <= 0)
+    return;
+#ifdef GT_USE_BLAS
+  cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k,
+	      alpha, A, lda, B, ldb, beta, C, ldc);
+  return;
+#endif
+#ifdef CK_X86
+  if(k > 0 && (double)m*n*k >= CK_GEMM_MIN) {
+    if(ck_current == CK_ISA_AVX512) {
+      gemm_blocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, stile_avx512, 32);
+      return;
+    }
+    if(ck_current == CK_ISA_AVX2) {
+      gemm_blocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, stile_avx2, 16);
+      return;
+    }
+  }
+#endif
+  ck_sgemm_ref(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void ck_axpy(int n, double a, const double *x, double *y) {
+#ifdef CK_X86
+  if(ck_current == CK_ISA_AVX512) {
+    axpy_avx512(n, a, x, y);
+    return;
+  }
+  if(ck_current == CK_ISA_AVX2) {
+    axpy_avx2(n, a, x, y);
+    return;
+  }
+#endif
+  ck_axpy_ref(n, a, x, y);
+}
+
+void ck_saxpy(int n, float a, const float *x, float *y) {
+#ifdef CK_X86
+  if(ck_current == CK_ISA_AVX512) {
+    saxpy_avx512(n, a, x, y);
+    return;
+  }
+  if(ck_current == CK_ISA_AVX2) {
+    saxpy_avx2(n, a, x, y);
+    return;
+  }
+#endif
+  ck_saxpy_ref(n, a, x, y);
+}
+
+void ck_pivot(int n, double a, double b, double c, const double *x, double *y) {
+#ifdef CK_X86
+  if(ck_current == CK_ISA_AVX512) {
+    pivot_avx512(n, a, b, c, x, y);
+    return;
+  }
+  if(ck_current == CK_ISA_AVX2) {
+    pivot_avx2(n, a, b, c, x, y);
+    return;
+  }
+#endif
+  ck_pivot_ref(n, a, b, c, x, y);
+}
+
+void ck_gemv(int m, int n, const double *A, int lda, const double *x, double *y) {
+#ifdef GT_USE_BLAS
+  if(m > 0)
+    cblas_dgemv(CblasRowMajor, CblasNoTrans, m, n, 1.0, A, lda, x, 1, 0.0, y, 1);
+  return;
+#endif
+#ifdef CK_X86
+  if(n >= CK_GEMV_MIN) {
+    if(ck_current == CK_ISA_AVX512) {
+      gemv_avx512(m, n, A, lda, x, y);
+      return;
+    }
+    if(ck_current == CK_ISA_AVX2) {
+      gemv_avx2(m, n, A, lda, x, y);
+      return;
+    }
+  }
+#endif
+  ck_gemv_ref(m, n, A, lda, x, y);
+}
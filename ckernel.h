@@ -0,0 +1,78 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __CKERNEL_H
+#define __CKERNEL_H
+
+#include <stddef.h>
+
+// Dense kernels underneath cmatrix.  Matrices are row-major, with an
+// explicit leading dimension (the distance between consecutive rows).
+// The plain entry points pick an AVX2 or AVX-512 implementation at run
+// time if the processor has one; the _ref versions are the simple
+// scalar loops, kept as a reference to check the tuned code against.
+
+enum { CK_ISA_SCALAR = 0, CK_ISA_AVX2 = 1, CK_ISA_AVX512 = 2 };
+
+// the instruction set ck_gemm, ck_sgemm and ck_gemv currently dispatch to
+int ck_isa();
+
+// limit dispatch to at most the given instruction set, e.g.
+// CK_ISA_SCALAR to run everything through the reference code.
+// Returns the instruction set actually selected.
+int ck_set_isa(int isa);
+
+// C = alpha*A*B + beta*C, where A is m x k and B is k x n.  C must not
+// overlap A or B.  If beta is 0, C is not read.
+void ck_gemm(int m, int n, int k, double alpha, const double *A, int lda,
+	     const double *B, int ldb, double beta, double *C, int ldc);
+void ck_gemm_ref(int m, int n, int k, double alpha, const double *A, int lda,
+		 const double *B, int ldb, double beta, double *C, int ldc);
+
+// the same in single precision
+void ck_sgemm(int m, int n, int k, float alpha, const float *A, int lda,
+	      const float *B, int ldb, float beta, float *C, int ldc);
+void ck_sgemm_ref(int m, int n, int k, float alpha, const float *A, int lda,
+		  const float *B, int ldb, float beta, float *C, int ldc);
+
+// y += a*x over n entries, in double and single precision
+void ck_axpy(int n, double a, const double *x, double *y);
+void ck_axpy_ref(int n, double a, const double *x, double *y);
+void ck_saxpy(int n, float a, const float *x, float *y);
+void ck_saxpy_ref(int n, float a, const float *x, float *y);
+
+// y = (a*y - b*x) * c over n entries: one row of a Lemke-Howson pivot,
+// with x the pivot row and c the reciprocal of the previous pivot
+void ck_pivot(int n, double a, double b, double c, const double *x, double *y);
+void ck_pivot_ref(int n, double a, double b, double c, const double *x, double *y);
+
+// y = A*x, where A is m x n.  y must not overlap A or x.
+void ck_gemv(int m, int n, const double *A, int lda, const double *x, double *y);
+void ck_gemv_ref(int m, int n, const double *A, int lda, const double *x, double *y);
+
+// A per-thread scratch area of at least n doubles, 64-byte aligned.  It
+// is reused by the next call on the same thread, so it must not be held
+// across calls into other cmatrix routines.
+double *ck_workspace(size_t n);
+
+// 64-byte aligned allocation, released with ck_free
+void *ck_malloc(size_t bytes);
+void ck_free(void *p);
+
+#endif
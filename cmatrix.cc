@@ -20,63 +20,270 @@
 #include "cmatrix.h"
 #include "math.h"
 #include "float.h"
-cvector::~cvector() { delete []x; }
+#include "threadpool.h"
+#include <vector>
+
+#ifdef GT_USE_BLAS
+// Fortran LAPACK entry points (every LAPACK, including OpenBLAS and MKL,
+// exports these).  Character arguments are followed by their hidden
+// lengths.  cmatrix storage is row-major, so a cmatrix buffer handed to
+// LAPACK unchanged is read as the transpose.
+extern "C" {
+  void dgetrf_(const int *m, const int *n, double *a, const int *lda, int *ipiv, int *info);
+  void dgetrs_(const char *trans, const int *n, const int *nrhs, const double *a,
+	       const int *lda, const int *ipiv, double *b, const int *ldb, int *info, size_t);
+  void dgetri_(const int *n, double *a, const int *lda, const int *ipiv,
+	       double *work, const int *lwork, int *info);
+  void dgesdd_(const char *jobz, const int *m, const int *n, double *a, const int *lda,
+	       double *s, double *u, const int *ldu, double *vt, const int *ldvt,
+	       double *work, const int *lwork, int *iwork, int *info, size_t);
+}
+
+// solves a*x = b for the n x n row-major a, overwriting b with x.
+// Returns false if LAPACK finds a singular matrix.
+static bool lapack_solve(const double *a, int n, double *b) {
+	int info, one = 1;
+	double *t = ck_workspace((size_t)n*n);
+	int *ip = new int[n];
+	memcpy(t,a,(size_t)n*n*sizeof(double));
+	dgetrf_(&n,&n,t,&n,ip,&info);
+	if (info==0) // t holds the factors of a', so solve the transpose
+		dgetrs_("T",&n,&one,t,&n,ip,b,&n,&info,1);
+	delete []ip;
+	return info==0;
+}
+
+// inverts the n x n row-major a into dest.  The inverse of the
+// transpose is the transpose of the inverse, so no reordering is needed.
+static bool lapack_inv(const double *a, int n, double *dest) {
+	int info, lwork = -1;
+	double wq;
+	int *ip = new int[n];
+	memcpy(dest,a,(size_t)n*n*sizeof(double));
+	dgetrf_(&n,&n,dest,&n,ip,&info);
+	if (info==0) {
+		dgetri_(&n,dest,&n,ip,&wq,&lwork,&info);
+		lwork = (int)wq;
+		double *work = new double[lwork];
+		dgetri_(&n,dest,&n,ip,work,&lwork,&info);
+		delete []work;
+	}
+	delete []ip;
+	return info==0;
+}
+#endif
+
+cvector::~cvector() { release(); }
 // adopted from NRiC, pg 45
 
 cmatrix::~cmatrix()
- { delete []x; }
+ { release(); }
+
+thread_local gtstats gt_stats;
+thread_local int cvector::num_vec_cons = 0;
+thread_local int cvector::num_vec_copies = 0;
+thread_local int cmatrix::num_mat_copies = 0;
+int cmatrix::parallelThreshold = 256;
+
+// panel width for the blocked LU
+static const int LU_NB = 64;
+
+static inline void LUgemm(int m, int n, int k, const double *A, int lda,
+		const double *B, int ldb, double *C, int ldc) {
+	ck_gemm(m,n,k,-1.0,A,lda,B,ldb,1.0,C,ldc);
+}
+
+static inline void LUgemm(int m, int n, int k, const float *A, int lda,
+		const float *B, int ldb, float *C, int ldc) {
+	ck_sgemm(m,n,k,-1.0f,A,lda,B,ldb,1.0f,C,ldc);
+}
+
+static inline void LUaxpy(int n, double a, const double *x, double *y) {
+	ck_axpy(n,a,x,y);
+}
+
+static inline void LUaxpy(int n, float a, const float *x, float *y) {
+	ck_saxpy(n,a,x,y);
+}
+
+// Right-looking blocked version of the Crout loop in LUdecomp, in double
+// or single precision.  Pivots are chosen with the same scaled test, so
+// the rows interchanged and the packed L\U layout are the same; only the
+// order in which the sums are accumulated differs.  Each panel of LU_NB
+// columns is factored serially, then the block row to its right is
+// solved and the trailing matrix updated, in parallel if par is set.
+template <class T>
+static int LUblocked(T *a, int n, double *vv, int *ix, bool par) {
+	int d=1,i,j,k,j0,j1,imax;
+	int grain = par ? LU_NB : n;
+	double big,dum;
+	T t;
+	for(j0=0;j0<n;j0+=LU_NB) {
+		j1 = j0+LU_NB < n ? j0+LU_NB : n;
+		for(j=j0;j<j1;j++) {
+			big = 0;
+			imax = j;
+			for(i=j;i<n;i++)
+				if ((dum=vv[i]*fabs(a[i*n+j]))>=big) {
+					big = dum;
+					imax = i;
+				}
+			if (j!=imax) {
+				for(k=0;k<n;k++) {
+					t = a[imax*n+k];
+					a[imax*n+k] = a[j*n+k];
+					a[j*n+k] = t;
+				}
+				d = -d;
+				vv[imax] = vv[j];
+			}
+			ix[j] = imax;
+			if (a[j*n+j] == 0) {
+				a[j*n+j] = (T)1.0e-20;
+			}
+			if (j!=n-1) {
+				t = 1/a[j*n+j];
+				for(i=j+1;i<n;i++) {
+					a[i*n+j] *= t;
+					LUaxpy(j1-j-1,-a[i*n+j],a+j*n+j+1,a+i*n+j+1);
+				}
+			}
+		}
+		if (j1==n) break;
+		// U12 = inv(L11)*A12, by column blocks
+		gt_parallel_for(j1,n,grain,[=](int cb, int ce) {
+			for(int r=j0+1;r<j1;r++)
+				for(int q=j0;q<r;q++)
+					LUaxpy(ce-cb,-a[r*n+q],a+q*n+cb,a+r*n+cb);
+		});
+		// A22 -= L21*U12, by row blocks
+		gt_parallel_for(j1,n,grain,[=](int rb, int re) {
+			LUgemm(re-rb,n-j1,j1-j0,a+rb*n+j0,n,a+j0*n+j1,n,a+rb*n+j1,n);
+		});
+	}
+	return d;
+}
+
+// LUbacksub for factors in either precision, accumulating in double
+template <class T>
+static void LUsolve(const T *lu, int n, const int *ix, double *b) {
+	int ip,ii=-1,i,j;
+	double sum;
+
+	for(i=0;i<n;i++) {
+		ip = ix[i];
+		sum = b[ip];
+		b[ip] = b[i];
+		if (ii!=-1)
+			for(j=ii;j<=i-1;j++) sum -= lu[i*n+j]*b[j];
+		else if (sum!=0) ii=i;
+		b[i] = sum;
+	}
+	for(i=n-1;i>=0;i--) {
+		sum = b[i];
+		for(j=i+1;j<=n-1;j++) sum -= lu[i*n+j]*b[j];
+		b[i] = sum/lu[i*n+i];
+	}
+}
 
-int cvector::num_vec_cons = 0;
+// One elimination step of adjoint: rows other than the pivot row i are
+// updated fraction-free against pivot row i and column j, and their
+// column j entries negated.
+static void adjointRows(double *a, int m, int i, int j, double pivot,
+		double D, int b, int e) {
+	const double *p = a+i*m;
+	for(int i0=b;i0<e;i0++) {
+		if (i0==i) continue;
+		double *r = a+i0*m;
+		double f = r[j];
+		for(int j0=0;j0<m;j0++) {
+			double t = r[j0]*pivot;
+			t -= f*p[j0];
+			r[j0] = t/D;
+		}
+		r[j] = -f;
+	}
+}
 cmatrix cmatrix::inv(bool &worked) const {
 	if (m!=n) {
 		cerr << "invalid cmatrix inverse" << endl;
 		exit(1);
 	}
+#ifdef GT_USE_BLAS
+	{
+		cmatrix ret(n,n);
+		if (lapack_inv(x,n,ret.x)) {
+			worked = true;
+			return ret;
+		}
+	}
+#endif
 	cmatrix temp(n,n);
-	int *ix = new int[n];
+	std::vector<int> ix(n);
 	
-	if (!LUdecomp(temp,ix)) {
+	if (!LUdecomp(temp,&ix[0])) {
 		worked = false;
-		delete []ix;
 		return cmatrix(n,n,0,false);
 	}
 	worked = true;
 
 	cmatrix ret(n,n);
-	int i,j;
-	double *col = new double[n];
-	for(j=0;j<n;j++) {
-		for(i=0;i<n;i++) col[i] = 0;
-		col[j] = 1;
-		temp.LUbacksub(ix,col);
-		for(i=0;i<n;i++) ret.x[i*n+j] = col[i];
-	}
-	delete []col;
-	delete []ix;
+	int grain = n>=parallelThreshold ? 16 : n;
+	gt_parallel_for(0,n,grain,[&](int b, int e) {
+		double *col = new double[n];
+		for(int j=b;j<e;j++) {
+			for(int i=0;i<n;i++) col[i] = 0;
+			col[j] = 1;
+			temp.LUbacksub(&ix[0],col);
+			for(int i=0;i<n;i++) ret.x[i*n+j] = col[i];
+		}
+		delete []col;
+	});
 	return ret;
 }
 
-// adopted from NRiC, pg 43
 int cmatrix::LUdecomp(cmatrix &LU, int *ix) const {
+	std::vector<double> vv(n);
+	return LUdecomp(LU,ix,&vv[0]);
+}
+
+// adopted from NRiC, pg 43
+int cmatrix::LUdecomp(cmatrix &LU, int *ix, double *vv) const {
 	if (m!=n||LU.m!=LU.n||LU.n!=n) {
 		cerr << "invalid cmatrix in LUdecomp" << endl;
 		exit(1);
 	}
 	int d=1,i,j,k;
 	LU = *this;
-	double *vv = new double[n];
 	double dum;
 
 	k = 0;
 	for(i=0;i<n;i++) {
 		vv[i] = fabs(x[k]); k++;
 		for(j=1;j<n;j++,k++) if(vv[i]<(dum=fabs(x[k]))) vv[i]=dum;
-		if (vv[i]==(double)0.0) {
-			delete []vv;
-			return 0;
-		}
+		if (vv[i]==(double)0.0) return 0;
 		vv[i] = 1/vv[i];
 	}
+#ifdef GT_USE_BLAS
+	// LAPACK pivots on magnitude rather than scaled magnitude, but
+	// produces the same packed L\U layout and row interchanges
+	{
+		int info;
+		double *t = ck_workspace(s);
+		for(i=0;i<n;i++) for(j=0;j<n;j++) t[j*n+i] = x[i*n+j];
+		dgetrf_(&n,&n,t,&n,ix,&info);
+		for(i=0;i<n;i++) for(j=0;j<n;j++) LU.x[i*n+j] = t[j*n+i];
+		for(j=0;j<n;j++) {
+			if (--ix[j]!=j) d = -d;
+			if (LU.x[j*n+j]==0) LU.x[j*n+j] = (double)1.0e-20;
+		}
+		return d;
+	}
+#endif
+	if (n>=parallelThreshold) {
+		d = LUblocked(LU.x,n,vv,ix,true);
+		return d;
+	}
 	double sum,big;
 	int imax;
 	for(j=0;j<n;j++) {
@@ -113,7 +320,6 @@ int cmatrix::LUdecomp(cmatrix &LU, int *ix) const {
 			for(i=j+1;i<n;i++) LU.x[i*n+j] *= dum;
 		}
 	}
-	delete []vv;
 	return d;
 }
 
@@ -141,44 +347,272 @@ void cmatrix::LUbacksub(int *ix, double *b) const {
 	}
 }
 
-bool cmatrix::solve(cvector &b, cvector &ret) {
+bool cmatrix::solve(cvector &b, cvector &ret, solvemode mode) {
 	if (m!=n) {
 		cerr << "invalid cmatrix in solve" << endl;
 		exit(1);
 	}
+	if (mode==SOLVE_MIXED) {
+		cmatrixlu lu;
+		return lu.factor(*this,mode) && lu.solve(b,ret);
+	}
+	GT_STAT_CALL(GT_KSOLVE,2.0/3*n*n*n+2.0*n*n,8.0*(3.0*n*n+3.0*n));
 	for(int i=0;i<n;i++) ret[i] = b[i];
-	int *ix = new int[n];
+#ifdef GT_USE_BLAS
+	if (lapack_solve(x,n,ret.values())) return true;
+	for(int i=0;i<n;i++) ret[i] = b[i];
+#endif
+	std::vector<int> ix(n);
 	cmatrix a(n,n);
 	
-	if (!LUdecomp(a,ix)) {
-		delete []ix;
-		return false;
-	}
-	a.LUbacksub(ix,ret.values());
-	delete []ix;
+	if (!LUdecomp(a,&ix[0])) return false;
+	a.LUbacksub(&ix[0],ret.values());
 	return true;
 }
-double *cmatrix::solve(const double *b, bool &worked) const {
+double *cmatrix::solve(const double *b, bool &worked, solvemode mode) const {
 	if (m!=n) {
 		cerr << "invalid cmatrix in solve" << endl;
 		exit(1);
 	}
 	double *ret = new double[n];
+	if (mode==SOLVE_MIXED) {
+		cmatrixlu lu;
+		worked = lu.factor(*this,mode) && lu.solve(b,ret);
+		return ret;
+	}
+	GT_STAT_CALL(GT_KSOLVE,2.0/3*n*n*n+2.0*n*n,8.0*(3.0*n*n+3.0*n));
 	for(int i=0;i<n;i++) ret[i] = b[i];
-	int *ix = new int[n];
+#ifdef GT_USE_BLAS
+	if (lapack_solve(x,n,ret)) {
+		worked = true;
+		return ret;
+	}
+	for(int i=0;i<n;i++) ret[i] = b[i];
+#endif
+	std::vector<int> ix(n);
 	cmatrix a(n,n);
 	
-	if (!LUdecomp(a,ix)) {
+	if (!LUdecomp(a,&ix[0])) {
 		worked = false;
-		delete []ix;
 		return ret;
 	}
 	worked=true;
-	a.LUbacksub(ix,ret);
-	delete []ix;
+	a.LUbacksub(&ix[0],ret);
 	return ret;
 }
 
+cmatrixlu::cmatrixlu() : a(0), n(0), dsign(0), mode(cmatrix::SOLVE_DOUBLE),
+	d(0), lf(0), ld(1,1), ix(0), vv(0) { }
+
+cmatrixlu::~cmatrixlu() {
+	if (lf) ck_free(lf);
+	delete []ix;
+	delete []vv;
+}
+
+bool cmatrixlu::factor(const cmatrix &a, cmatrix::solvemode mode) {
+	if (a.m!=a.n) {
+		cerr << "invalid cmatrix in cmatrixlu" << endl;
+		exit(1);
+	}
+	if (n!=a.n) {
+		if (lf) ck_free(lf);
+		lf = 0;
+		delete []ix;
+		delete []vv;
+		n = a.n;
+		ix = new int[n];
+		vv = new double[n];
+	}
+	this->a = &a;
+	this->mode = mode;
+	d = 0;
+	dsign = 0;
+	GT_STAT_CALL(GT_KSOLVE,0,0);
+	if (mode!=cmatrix::SOLVE_MIXED)
+		return factorDouble();
+
+	GT_STAT_WORK(GT_KSOLVE,2.0/3*n*n*n,8.0*n*n+8.0*n*n);
+	if (!lf) lf = (float *)ck_malloc((size_t)n*n*sizeof(float));
+	int i,j;
+	for(i=0;i<n;i++) {
+		const double *r = a.x+(size_t)i*n;
+		vv[i] = 0;
+		for(j=0;j<n;j++) {
+			lf[(size_t)i*n+j] = (float)r[j];
+			if (vv[i]<fabs(r[j])) vv[i] = fabs(r[j]);
+		}
+		if (vv[i]==(double)0.0) return false;
+		vv[i] = 1/vv[i];
+	}
+	dsign = LUblocked(lf,n,vv,ix,n>=cmatrix::parallelThreshold);
+	d = dsign;
+	for(i=0;i<n;i++) {
+		d *= lf[(size_t)i*n+i];
+		if (lf[(size_t)i*n+i]<0) dsign = -dsign;
+	}
+	return true;
+}
+
+bool cmatrixlu::factorDouble() {
+	GT_STAT_WORK(GT_KSOLVE,2.0/3*n*n*n,24.0*n*n);
+	if (ld.m!=n) ld = cmatrix(n,n);
+	dsign = a->LUdecomp(ld,ix,vv);
+	if (!dsign) {
+		d = 0;
+		return false;
+	}
+	mode = cmatrix::SOLVE_DOUBLE;
+	d = dsign;
+	for(int i=0;i<n;i++) {
+		d *= ld.x[i*n+i];
+		if (ld.x[i*n+i]<0) dsign = -dsign;
+	}
+	return true;
+}
+
+// Iterative refinement: each round computes the residual in double and
+// the componentwise backward error max |r_i| / (|A||x| + |b|)_i.  The
+// solve is done once that error is as small as a double factorization
+// leaves it; if it stops halving, or after LU_REFINE_MAX corrections,
+// the single precision factors are given up on.
+#define LU_REFINE_MAX 30
+
+bool cmatrixlu::solve(const double *b, double *x) {
+	double *w = ck_workspace(2*(size_t)n), *r = w, *b0 = w+n;
+	int i,j,it;
+	memcpy(b0,b,n*sizeof(double));
+	memcpy(x,b0,n*sizeof(double));
+	if (mode!=cmatrix::SOLVE_MIXED) {
+		GT_STAT_CALL(GT_KSOLVE,2.0*n*n,8.0*n*n+24.0*n);
+		LUsolve(ld.x,n,ix,x);
+		return true;
+	}
+	GT_STAT_CALL(GT_KSOLVE,2.0*n*n,4.0*n*n+24.0*n);
+	LUsolve(lf,n,ix,x);
+	double tol = DBL_EPSILON*sqrt((double)n), berr, last = DBL_MAX, ri, si, t;
+	for(it=0;it<=LU_REFINE_MAX;it++) {
+		berr = 0;
+		for(i=0;i<n;i++) {
+			const double *ai = a->x+(size_t)i*n;
+			ri = b0[i];
+			si = fabs(ri);
+			for(j=0;j<n;j++) {
+				t = ai[j]*x[j];
+				ri -= t;
+				si += fabs(t);
+			}
+			r[i] = ri;
+			if (fabs(ri)>berr*si) berr = si>0 ? fabs(ri)/si : DBL_MAX;
+		}
+		if (berr<=tol) return true;
+		if (it==LU_REFINE_MAX || !(berr<=0.5*last)) break;
+		last = berr;
+		// a residual and a correction
+		GT_STAT_WORK(GT_KSOLVE,6.0*n*n,12.0*n*n+40.0*n);
+		LUsolve(lf,n,ix,r);
+		for(i=0;i<n;i++) x[i] += r[i];
+	}
+	// the single precision factors are too inaccurate for this matrix
+	memcpy(x,b0,n*sizeof(double));
+	if (!factorDouble()) return false;
+	GT_STAT_WORK(GT_KSOLVE,2.0*n*n,8.0*n*n+24.0*n);
+	LUsolve(ld.x,n,ix,x);
+	return true;
+}
+
+bool cmatrixlu::solve(const cvector &b, cvector &dest) {
+	if (b.m!=n || dest.m!=n) {
+		cerr << "invalid cvector in cmatrixlu solve" << endl;
+		exit(1);
+	}
+	return solve(b.x,dest.x);
+}
+
+csupportproj::csupportproj() : m(0), nb(0), cap(0), boff(0), ix(0), on(0) { }
+
+csupportproj::~csupportproj() {
+	delete []boff;
+	delete []ix;
+	delete []on;
+}
+
+void csupportproj::set(int nb, const int *off, const int *support) {
+	int b,i,k;
+	if (off[nb]>cap) {
+		delete []ix;
+		delete []on;
+		cap = off[nb];
+		ix = new int[cap];
+		on = new unsigned char[cap];
+	}
+	if (nb!=this->nb) {
+		delete []boff;
+		boff = new int[nb+1];
+	}
+	this->nb = nb;
+	m = off[nb];
+	k = 0;
+	for(b=0;b<nb;b++) {
+		boff[b] = k;
+		for(i=off[b];i<off[b+1];i++)
+			if ((on[i] = support[i]!=0)) ix[k++] = i;
+	}
+	boff[nb] = k;
+}
+
+void csupportproj::multiply(const cvector &source, cvector &dest) const {
+	if (source.getm()!=m || dest.getm()!=m) {
+		cerr << "invalid csupportproj multiply" << endl;
+		exit(1);
+	}
+	const double *sv = source.values();
+	double *dv = dest.values();
+	int b,i;
+	for(i=0;i<m;i++)
+		if (!on[i]) dv[i] = 0.0;
+	for(b=0;b<nb;b++) {
+		if (boff[b]==boff[b+1]) continue;
+		double mean = 0.0;
+		for(i=boff[b];i<boff[b+1];i++) mean += sv[ix[i]];
+		mean /= boff[b+1]-boff[b];
+		for(i=boff[b];i<boff[b+1];i++) dv[ix[i]] = sv[ix[i]]-mean;
+	}
+}
+
+void csupportproj::dense(cmatrix &dest) const {
+	int b,i,j;
+	dest.reshape(m,m);
+	dest = 0.0;
+	for(b=0;b<nb;b++) {
+		double t = 1.0/(boff[b+1]-boff[b]);
+		for(i=boff[b];i<boff[b+1];i++)
+			for(j=boff[b];j<boff[b+1];j++)
+				dest[ix[i]][ix[j]] = (i==j) ? 1.0-t : -t;
+	}
+}
+
+cmatrix &cmatrix::operator*=(const csupportproj &p) {
+	if (n!=p.m) {
+		cerr << "invalid cmatrix-csupportproj multiply" << endl;
+		exit(1);
+	}
+	int r,b,i;
+	for(r=0;r<m;r++) {
+		double *row = x+r*n;
+		for(i=0;i<n;i++)
+			if (!p.on[i]) row[i] = 0.0;
+		for(b=0;b<p.nb;b++) {
+			if (p.boff[b]==p.boff[b+1]) continue;
+			double mean = 0.0;
+			for(i=p.boff[b];i<p.boff[b+1];i++) mean += row[p.ix[i]];
+			mean /= p.boff[b+1]-p.boff[b];
+			for(i=p.boff[b];i<p.boff[b+1];i++) row[p.ix[i]] -= mean;
+		}
+	}
+	return *this;
+}
+
 double cmatrix::pythag(double a, double b) {
 	double absa,absb;
 	absa = fabs(a);
@@ -199,12 +633,33 @@ double cmatrix::pythag(double a, double b) {
 void cmatrix::svd(cmatrix &u, cmatrix &v, double *w) {
 
 	u = *this;
-	if (v.n!=n || v.m!=n) {
-		delete []v.x;
-		v.n = n; v.m = n;
-		v.s = n*n;
-		v.x = new double[v.s];
+	if (v.n!=n || v.m!=n) v.reshape(n,n);
+#ifdef GT_USE_BLAS
+	// The buffer is a' (n x m, column-major), and a' = U' W V'' gives
+	// a = V' W U''.  So LAPACK's VT for a' is our u, row-major as it
+	// stands, and our v is the transpose of LAPACK's U.
+	if (m>=n) {
+		int info, lwork = -1;
+		double wq;
+		double *a = new double[s], *uu = new double[n*n], *vt = new double[s];
+		int *iwork = new int[8*n];
+		memcpy(a,x,s*sizeof(double));
+		dgesdd_("S",&n,&m,a,&n,w,uu,&n,vt,&n,&wq,&lwork,iwork,&info,1);
+		lwork = (int)wq;
+		double *work = new double[lwork];
+		dgesdd_("S",&n,&m,a,&n,w,uu,&n,vt,&n,work,&lwork,iwork,&info,1);
+		if (info==0) {
+			memcpy(u.x,vt,s*sizeof(double));
+			for(int r=0;r<n;r++) for(int c=0;c<n;c++) v.x[r*n+c] = uu[c*n+r];
+		}
+		delete []work;
+		delete []iwork;
+		delete []vt;
+		delete []uu;
+		delete []a;
+		if (info==0) return;
 	}
+#endif
 
 	int flag,i,its,j,jj,k,l,nm;
 	double anorm,c,f,g,h,s,scale,x,y,z,*rv1;
@@ -395,16 +850,18 @@ void cmatrix::svd(cmatrix &u, cmatrix &v, double *w) {
 }
 
 double cmatrix::adjoint() {
-  int i, j, i0, j0, maxi, lastj = -1;
+  int i, j, maxi, lastj = -1;
   double max, pivot;
   int r[m];
   int r2[m];
   int c[m];
   double D = 1.0;
-  double retval[m][m];
-  for(i = 0; i < m; i++)
-    for(j = 0; j < m; j++)
-      retval[i][j] = x[i*n+j];
+  double *a = ck_workspace((size_t)m*m);
+  double (*retval)[m] = (double (*)[m])a;
+  memcpy(a, x, (size_t)m*m*sizeof(double));
+  int grain = m >= parallelThreshold ? 16 : m;
+  // the copies in and out; each step below is counted as it is made
+  GT_STAT_CALL(GT_KADJOINT, 0, 32.0*m*m);
 
   for(i= 0; i < m; i++) {
     r[i] = -1;
@@ -434,20 +891,10 @@ double cmatrix::adjoint() {
 
     i = maxi;
     pivot = retval[i][j];
-    for(i0 = 0; i0 < m; i0++) {
-      if(i0 != i) {
-	for(j0 = 0; j0 < m; j0++) {
-	  if(j0 != j) {
-	    retval[i0][j0] *= pivot;
-	    retval[i0][j0] -= retval[i0][j] * retval[i][j0];
-	    retval[i0][j0] /= D;
-	  }
-	}
-      }
-    }
-    for(i0 = 0; i0 < m; i0++) {
-      retval[i0][j] = -retval[i0][j];
-    }
+    gt_parallel_for(0, m, grain, [=](int b, int e) {
+      adjointRows(a, m, i, j, pivot, D, b, e);
+    });
+    GT_STAT_WORK(GT_KADJOINT, 4.0*(m-1)*m, 16.0*(m-1)*m + 8.0*m);
     retval[i][j] = D;
     D = pivot;
     r[i] = j;
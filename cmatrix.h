@@ -41,9 +41,23 @@
 #include <assert.h>
 #include <string>
 #include <iomanip>
+#include "ckernel.h"
+#include "gtstats.h"
+#include <stdint.h>
+#include <utility>
+
+// Storage for cvector and cmatrix is 64-byte aligned.  Objects of up to
+// CV_INLINE (cvector) or CM_INLINE (cmatrix) doubles keep their values
+// inside the object, so small games run without touching the heap.  The
+// inline array has 7 spare doubles so that an aligned window can be
+// found in it wherever the object itself lands.
+#define CV_INLINE 16
+#define CM_INLINE 256
 
 using namespace std;
 class cmatrix;
+class cmatrixlu;
+class csupportproj;
 
 class cmatrixrow {
 public:
@@ -52,48 +66,123 @@ public:
 	}
 };
 
-class cvector {
+// Expression templates for cvector arithmetic.  The operators below
+// return nodes that describe an elementwise expression rather than a new
+// vector, so z = z + dz*delta or err = -(err/k + g0 + s - z) is
+// evaluated in one loop when assigned to a cvector, with no scratch
+// vectors.  Nodes refer to the vectors they read, so an expression must
+// be assigned (or converted to a cvector) in the statement that builds
+// it.  The left-to-right order of the operations is kept, so each
+// element is computed exactly as the separate passes would have.
+template <class E> class cvexpr {
+public:
+	inline const E &self() const { return static_cast<const E &>(*this); }
+
+	inline double norm2() const {
+		const E &e = self();
+		double ret = e[0]*e[0];
+		for(int i=1;i<e.getm();i++) ret += e[i]*e[i];
+		return ret;
+	}
+	inline double norm() const {
+		return sqrt(norm2());
+	}
+};
+
+// how a node holds an operand: vectors by reference, nodes by value
+class cvector;
+template <class E> struct cvoperand { typedef const E type; };
+template <> struct cvoperand<cvector> { typedef const cvector &type; };
+
+struct cvadd { static inline double apply(double a, double b) { return a+b; } };
+struct cvsub { static inline double apply(double a, double b) { return a-b; } };
+struct cvmul { static inline double apply(double a, double b) { return a*b; } };
+struct cvdiv { static inline double apply(double a, double b) { return a/b; } };
+struct cvrsub { static inline double apply(double a, double b) { return b-a; } };
+struct cvneg { static inline double apply(double a, double) { return -a; } };
+
+// elementwise l op r
+template <class L, class R, class Op>
+class cvbinary : public cvexpr<cvbinary<L,R,Op> > {
+public:
+	inline cvbinary(const L &l, const R &r) : l(l), r(r) { }
+	inline double operator[](int i) const { return Op::apply(l[i],r[i]); }
+	inline int getm() const { return l.getm(); }
+private:
+	typename cvoperand<L>::type l;
+	typename cvoperand<R>::type r;
+};
+
+// elementwise l op a, for a scalar a
+template <class L, class Op>
+class cvscalar : public cvexpr<cvscalar<L,Op> > {
+public:
+	inline cvscalar(const L &l, double a) : l(l), a(a) { }
+	inline double operator[](int i) const { return Op::apply(l[i],a); }
+	inline int getm() const { return l.getm(); }
+private:
+	typename cvoperand<L>::type l;
+	double a;
+};
+
+class cvector : public cvexpr<cvector> {
 friend class cmatrix;
+friend class cmatrixlu;
 public:
- static int num_vec_cons; 
+ static thread_local int num_vec_cons; 
+ // deep copies made by the copy constructor; moves are not counted
+ static thread_local int num_vec_copies;
 	inline cvector() {
 	  cvector::num_vec_cons++;
 		m = 1;
-		x = new double[1];
+		alloc();
 	}
-	inline cvector(int m) {
+	// explicit, so that v*k never reads as a dot product with cvector(k)
+	explicit inline cvector(int m) {
 	  cvector::num_vec_cons++;
 		this->m = m;
-		x = new double[m];
+		alloc();
 	}
 	~cvector(); 
 	inline cvector(const cvector &v) {
 	  cvector::num_vec_cons++;
+	  cvector::num_vec_copies++;
 		m = v.m;
-		x = new double[m];
+		alloc();
 		//for(int i=0;i<m;i++) x[i] = v.x[i];
 		memcpy(x,v.x,m*sizeof(double));
 	}
+	// takes over v's heap storage, leaving v empty; inline values
+	// are copied and v keeps them
+	inline cvector(cvector &&v) noexcept {
+	  cvector::num_vec_cons++;
+		m = v.m;
+		take(v);
+	}
 	inline cvector(int m, const double &a) {
 	  cvector::num_vec_cons++;
 		this->m = m;
-		x = new double[m];
+		alloc();
 		for(int i=0;i<m;i++) x[i] = a;
 	}
+	// with keep, the vector takes over v, which must come from new[]
 	inline cvector(double *v, int m, bool keep=false) {
 	  cvector::num_vec_cons++;
 		this->m = m;
-		if (keep) x = v;
-		else {
-			x = new double[m];
+		if (keep) {
+			x = v;
+			adopted = true;
+		} else {
+			alloc();
 			//for(int i=0;i<m;i++) x[i] = v[i];
 			memcpy(x,v,m*sizeof(double));
 		}
 	}
-	inline cvector operator-() const {
-		cvector ret(m);
-		for(int i=0;i<m;i++) ret.x[i] = -x[i];
-		return ret;
+	template <class E> inline cvector(const cvexpr<E> &e) {
+	  cvector::num_vec_cons++;
+		m = e.self().getm();
+		alloc();
+		assign(e.self());
 	}
 	inline cvector& operator=(double a) {
 		for(int i=0;i<m;i++) x[i] = a;
@@ -101,15 +190,26 @@ public:
 	}
 	inline cvector& operator=(const cvector &v) {
 		if (&v==this) return *this;
-		if (v.m != m) {
-			delete []x;
-			m = v.m;
-			x = new double[m];
-		}
+		if (v.m != m) resize(v.m);
 		//for(int i=0;i<m;i++) x[i] = v.x[i];
 		memcpy(x,v.x,m*sizeof(double));
 		return *this;
 	}
+	inline cvector& operator=(cvector &&v) noexcept {
+		if (&v==this) return *this;
+		release();
+		m = v.m;
+		take(v);
+		return *this;
+	}
+	// an expression may read this vector; every element is read before
+	// it is written.  If the size changes, the expression is evaluated
+	// into new storage first, as resizing would free what it reads.
+	template <class E> inline cvector& operator=(const cvexpr<E> &e) {
+		if (e.self().getm() != m) return *this = cvector(e);
+		assign(e.self());
+		return *this;
+	}
 	inline bool isvalid() const {
 		for(int i=0;i<m;i++) if (!finite(x[i])) return false;
 		return true;
@@ -123,6 +223,16 @@ public:
 		for(int i=0;i<m;i++) ret += x[i]*v.x[i];
 		return ret;
 	}
+	template <class E> inline double operator*(const cvexpr<E> &e) const {
+		const E &v = e.self();
+		if (m!=v.getm()) {
+			cerr << "invalid cvector dot product" << endl;
+			assert(0);
+		}
+		double ret = 0.0;
+		for(int i=0;i<m;i++) ret += x[i]*v[i];
+		return ret;
+	}
 	inline double operator*(const double *v) const {
 		double ret = 0.0;
 		for(int i=0;i<m;i++) ret += x[i]*v[i];
@@ -157,6 +267,24 @@ public:
 		for(int i=0;i<m;i++) x[i] -= v.x[i];
 		return *this;
 	}
+	template <class E> inline cvector &operator+=(const cvexpr<E> &e) {
+		const E &v = e.self();
+		if (v.getm()!=m) {
+			cerr << "invalid cvector addition" << endl;
+			assert(0);
+		}
+		for(int i=0;i<m;i++) x[i] += v[i];
+		return *this;
+	}
+	template <class E> inline cvector &operator-=(const cvexpr<E> &e) {
+		const E &v = e.self();
+		if (v.getm()!=m) {
+			cerr << "invalid cvector subtraction" << endl;
+			assert(0);
+		}
+		for(int i=0;i<m;i++) x[i] -= v[i];
+		return *this;
+	}
 	inline cvector &operator*=(const double &a) {
 		for(int i=0;i<m;i++) x[i] *= a;
 		return *this;
@@ -246,6 +374,9 @@ public:
 	inline double *values() {
 		return x;
 	}
+	inline const double *values() const {
+		return x;
+	}
 	
 	inline int getm() const { return m; }
 
@@ -280,40 +411,106 @@ public:
 	  }
 	}
 
+	// changes the length, leaving the values undefined
+	inline void resize(int newm) {
+		release();
+		m = newm;
+		alloc();
+	}
+
 private:
+	inline double *inlinebuf() {
+		return (double *)(((uintptr_t)sbuf+63) & ~(uintptr_t)63);
+	}
+	inline void alloc() {
+		adopted = false;
+		if (m<=CV_INLINE) x = inlinebuf();
+		else {
+			x = (double *)ck_malloc(m*sizeof(double));
+			GT_STAT_ALLOC(m*sizeof(double));
+		}
+	}
+	inline void release() {
+		if (adopted) delete []x;
+		else if (x!=inlinebuf()) {
+			ck_free(x);
+			GT_STAT_FREE(m*sizeof(double));
+		}
+	}
+	template <class E> inline void assign(const E &e) {
+		for(int i=0;i<m;i++) x[i] = e[i];
+	}
+	// storage for this (whose m is set) from v: v's heap buffer, after
+	// which v is empty, or a copy of its inline values, which v keeps
+	inline void take(cvector &v) {
+		if (v.x==v.inlinebuf()) {
+			alloc();
+			memcpy(x,v.x,m*sizeof(double));
+		} else {
+			x = v.x;
+			adopted = v.adopted;
+			v.m = 0;
+			v.x = v.inlinebuf();
+			v.adopted = false;
+		}
+	}
+
 	int m;
 	double *x;
+	bool adopted;
+	double sbuf[CV_INLINE+7];
 };
 
 inline double max(double f1, double f2) {
         return ((f1 > f2) ? f1 : f2);
 }
-inline cvector operator+(const cvector &a, const cvector &b) {
-	return cvector(a)+=b;
+template <class L, class R>
+inline cvbinary<L,R,cvadd> operator+(const cvexpr<L> &a, const cvexpr<R> &b) {
+	if (a.self().getm()!=b.self().getm()) {
+		cerr << "invalid cvector addition" << endl;
+		assert(0);
+	}
+	return cvbinary<L,R,cvadd>(a.self(),b.self());
+}
+template <class L, class R>
+inline cvbinary<L,R,cvsub> operator-(const cvexpr<L> &a, const cvexpr<R> &b) {
+	if (a.self().getm()!=b.self().getm()) {
+		cerr << "invalid cvector subtraction" << endl;
+		assert(0);
+	}
+	return cvbinary<L,R,cvsub>(a.self(),b.self());
 }
-inline cvector operator-(const cvector &a, const cvector &b) {
-	return cvector(a)-=b;
+template <class L>
+inline cvscalar<L,cvadd> operator+(const cvexpr<L> &a, double b) {
+	return cvscalar<L,cvadd>(a.self(),b);
 }
-inline cvector operator+(const cvector &a, const double &b) {
-	return cvector(a)+=b;
+template <class L>
+inline cvscalar<L,cvsub> operator-(const cvexpr<L> &a, double b) {
+	return cvscalar<L,cvsub>(a.self(),b);
 }
-inline cvector operator-(const cvector &a, const double &b) {
-	return cvector(a)-=b;
+template <class L>
+inline cvscalar<L,cvadd> operator+(double a, const cvexpr<L> &b) {
+	return cvscalar<L,cvadd>(b.self(),a);
 }
-inline cvector operator+(const double &a, const cvector &b) {
-	return cvector(b)+=a;
+template <class L>
+inline cvscalar<L,cvrsub> operator-(double a, const cvexpr<L> &b) {
+	return cvscalar<L,cvrsub>(b.self(),a);
 }
-inline cvector operator-(const double &a, const cvector &b) {
-	return cvector(b.getm(),a)-=b;
+template <class L>
+inline cvscalar<L,cvmul> operator*(const cvexpr<L> &a, double b) {
+	return cvscalar<L,cvmul>(a.self(),b);
 }
-inline cvector operator*(const cvector &a, const double &b) {
-	return cvector(a)*=b;
+template <class L>
+inline cvscalar<L,cvmul> operator*(double a, const cvexpr<L> &b) {
+	return cvscalar<L,cvmul>(b.self(),a);
 }
-inline cvector operator*(const double &a, const cvector &b) {
-	return cvector(b)*=a;
+template <class L>
+inline cvscalar<L,cvdiv> operator/(const cvexpr<L> &a, double b) {
+	return cvscalar<L,cvdiv>(a.self(),b);
 }
-inline cvector operator/(const cvector &a, const double &b) {
-	return cvector(a)/=b;
+template <class L>
+inline cvscalar<L,cvneg> operator-(const cvexpr<L> &a) {
+	return cvscalar<L,cvneg>(a.self(),0.0);
 }
 
 inline ostream &operator<<(ostream &s, const cvector& v) {
@@ -325,26 +522,27 @@ inline ostream &operator<<(ostream &s, const cvector& v) {
 inline istream &operator>>(istream &s, cvector& v) {
 	int tm;
 	s >> tm;
-	if (tm!=v.m) {
-		delete []v.x;
-		v.m = tm;
-		v.x = new double[tm];
-	}
+	if (tm!=v.m) v.resize(tm);
 	for(int i=0;i<tm;i++) s >> v.x[i];
 	return s;
 }
 
 class cmatrix {
+friend class cmatrixlu;
 public:
+	// deep copies made by the copy constructor; moves are not counted
+	static thread_local int num_mat_copies;
+
 	inline cmatrix(int m=1, int n=1) {
 		this->m = m; this->n = n;
 		s = m*n;
-		x = new double[s];
+		alloc();
 	}
 	~cmatrix();
 	inline cmatrix(const cmatrix &ma, bool transpose=false) {
+		cmatrix::num_mat_copies++;
 		s = ma.m*ma.n;
-		x = new double[s];
+		alloc();
 		if (transpose) {
 			int i,j,c;
 			n = ma.m; m = ma.n;
@@ -361,7 +559,7 @@ public:
 		this->m = m;
 		this->n = n;
 		s = m*n;
-		x = new double[s];
+		alloc();
 		if (diaonly) {
 			int i;
 			//for(i=0;i<s;i++) x[i] = 0;
@@ -375,12 +573,18 @@ public:
 			else for(i=0;i<s;i++) x[i] = a;
 		}
 	}
+	// takes over ma's heap storage, leaving ma empty; inline values
+	// are copied and ma keeps them
+	inline cmatrix(cmatrix &&ma) noexcept {
+		m = ma.m; n = ma.n; s = ma.s;
+		take(ma);
+	}
 	// put v on the diagonal
 	inline cmatrix(int m, int n,const cvector &v) {
 		this->m = m;
 		this->n = n;
 		s = m*n;
-		x = new double[s];
+		alloc();
 		//for(int i=0;i<s;i++) x[i] = 0;
 		memset(x,0,s*sizeof(double));
 		int l = m;
@@ -392,7 +596,7 @@ public:
 		m = v.m;
 		n = 1;
 		s = m;
-		x = new double[s];
+		alloc();
 		//for(int i=0;i<s;i++) x[i] = v.x[i];
 		memcpy(x,v.x,s*sizeof(double));
 	}
@@ -402,7 +606,7 @@ public:
 		this->n = n;
 		s = m*n;
 		//int i;
-		x = new double[s];
+		alloc();
 		//for(i=0;i<s;i++) x[i] = v[i];
 		memcpy(x,v,s*sizeof(double));
 	}
@@ -411,14 +615,14 @@ public:
 	inline cmatrix(const cmatrix &v1, const cmatrix &v2) {
 		if (v1.n!=v2.n) {
 			s = 1;
-			m=1; n=1; x = new double[1];
+			m=1; n=1; alloc();
 			//x[0] = NaN;
 			//x[0] = 0.0/0.0;
 			x[0] = 0;
 		} else {
 			n = v2.m; m = v1.m;
 			s = n*m;
-			x = new double[s];
+			alloc();
 			int i,j,k,c=0;
 			for(i=0;i<m;i++) for(j=0;j<n;j++,c++) {
 				x[c] = 0;
@@ -431,7 +635,7 @@ public:
 	inline cmatrix(const cvector &v1, const cvector &v2) {
 		n = v2.m; m = v1.m;
 		s = n*m;
-		x = new double[s];
+		alloc();
 		int i,j,c=0;
 		for(i=0;i<m;i++) for(j=0;j<n;j++,c++)
 			x[c] = v1.x[i]*v2.x[j];
@@ -449,15 +653,18 @@ public:
 	}
 	inline cmatrix& operator=(const cmatrix &ma) {
 		if (&ma==this) return *this;
-		if (ma.n != n || ma.m != m) {
-			s = ma.s; m = ma.m; n = ma.n;
-			delete []x;
-			x = new double[s];
-		}
+		if (ma.n != n || ma.m != m) reshape(ma.m,ma.n);
 		//for(int i=0;i<s;i++) x[i] = ma.x[i];
 		memcpy(x,ma.x,s*sizeof(double));
 		return *this;
 	}
+	inline cmatrix& operator=(cmatrix &&ma) noexcept {
+		if (&ma==this) return *this;
+		release();
+		m = ma.m; n = ma.n; s = ma.s;
+		take(ma);
+		return *this;
+	}
 
 	inline bool isvalid() const {
 		for(int i=0;i<s;i++) if(!finite(x[i])) return false;
@@ -470,12 +677,7 @@ public:
 			assert(0);
 		}
 		cmatrix ret(m,ma.n);
-		int c=0;
-		for(int i=0;i<m;i++) for(int j=0;j<ma.n;j++,c++) {
-			ret.x[c] = 0;
-			for(int k=0;k<n;k++)
-				ret.x[c] += x[i*n+k] * ma.x[k*ma.n+j];
-		}
+		ck_gemm(m,ma.n,n,1.0,x,n,ma.x,ma.n,0.0,ret.x,ma.n);
 		return ret;
 	}
 	inline cvector operator*(const cvector &v) const {
@@ -484,12 +686,7 @@ public:
 			assert(0);
 		}
 		cvector ret(m);
-		int c = 0;
-		for(int i=0;i<m;i++,c+=n) {
-			ret.x[i] = 0;
-			for(int j=0;j<n;j++)
-				ret.x[i] += x[c+j] * v.x[j];
-		}
+		ck_gemv(m,n,x,n,v.x,ret.x);
 		return ret;
 	}
 
@@ -664,20 +861,15 @@ public:
 			cerr << "invalid cmatrix multiply" << endl;
 			assert(0);
 		}
-		int i,j,k,c=0;
-		double newrow[n];
-		for(i=0;i<m;i++) {
-		  for(j=0;j<n;j++) {
-		    newrow[j] = 0;
-		    for(k=0;k<n;k++)
-		      newrow[j] += x[c+k] * ma.x[k*n+j];
-		  }
-		  for(j=0; j < n; j++,c++)
-		    x[c] = newrow[j];
-		}
+		double *t = ck_workspace(s);
+		ck_gemm(m,n,n,1.0,x,n,ma.x,n,0.0,t,n);
+		memcpy(x,t,s*sizeof(double));
 		return *this;
 	}
 
+	// this = this*P, in time proportional to the size of this
+	cmatrix &operator*=(const csupportproj &p);
+
 	inline cmatrix &operator+=(const double &a) {
 		for(int i=0;i<s;i++) x[i] += a;
 		return *this;
@@ -761,13 +953,21 @@ public:
 
 	// LU decomposition -- ix is the row permutations
 	int LUdecomp(cmatrix &LU, int *ix) const;
+	// the same, with room in vv for the n row scale factors
+	int LUdecomp(cmatrix &LU, int *ix, double *vv) const;
 	// LU back substitution --
 	//    ix from above fn call (this should be an LU combination)
 	void LUbacksub(int *ix, double *col) const;
 
+	// how solve factors the matrix.  SOLVE_MIXED factors in single
+	// precision, then refines the answer against this matrix until it
+	// is as accurate as a double factorization would give; if the
+	// refinement does not converge it refactors in double.
+	enum solvemode { SOLVE_DOUBLE = 0, SOLVE_MIXED = 1 };
+
 	// solves equation Ax=b (A is this, x is the returned value)
-bool solve(cvector &b, cvector &dest);
-	double *solve(const double *b, bool &worked) const;
+bool solve(cvector &b, cvector &dest, solvemode mode=SOLVE_DOUBLE);
+	double *solve(const double *b, bool &worked, solvemode mode=SOLVE_DOUBLE) const;
 	inline double *solve(const double *b) const { bool w; return solve(b,w); }
 	
 	inline void negate() { for(int i = 0; i < s; i++) x[i] = -x[i]; }
@@ -775,18 +975,20 @@ bool solve(cvector &b, cvector &dest);
 	inline cmatrix inv() const { bool w; return inv(w); }
 	double adjoint();
 	inline double trace();
+
+	// LUdecomp, inv and adjoint of matrices at least this many rows
+	// are blocked and split across the shared thread pool (see
+	// threadpool.h); smaller ones run serially on the calling thread.
+	static int parallelThreshold;
+
 	double testAdjoint();
 	inline void multiply(const cvector &source, cvector &dest) {
 	  assert(n == source.m && m == dest.m);
-	  int i,j,c=0;
-	  for(i = 0; i < m; i++) {
-	    dest[i] = 0;
-	    for(j = 0; j < n; j++,c++)
-	      dest[i] += x[c] * source[j];
-	  }
+	  ck_gemv(m,n,x,n,source.x,dest.x);
 	}
 
 	inline double *values() { return x; }
+	inline const double *values() const { return x; }
 
 
 
@@ -829,39 +1031,202 @@ bool solve(cvector &b, cvector &dest);
 
 	inline void compact() { }
 
+	// changes the dimensions, leaving the values undefined
+	inline void reshape(int newm, int newn) {
+		if (newm*newn!=s) {
+			release();
+			s = newm*newn;
+			alloc();
+		}
+		m = newm; n = newn;
+	}
+
 private:
 	static double pythag(double a, double b);
 
+	inline double *inlinebuf() {
+		return (double *)(((uintptr_t)sbuf+63) & ~(uintptr_t)63);
+	}
+	inline void alloc() {
+		if (s<=CM_INLINE) x = inlinebuf();
+		else {
+			x = (double *)ck_malloc(s*sizeof(double));
+			GT_STAT_ALLOC(s*sizeof(double));
+		}
+	}
+	inline void release() {
+		if (x!=inlinebuf()) {
+			ck_free(x);
+			GT_STAT_FREE(s*sizeof(double));
+		}
+	}
+	// storage for this (whose s is set) from ma: ma's heap buffer, after
+	// which ma is empty, or a copy of its inline values, which ma keeps
+	inline void take(cmatrix &ma) {
+		if (ma.x==ma.inlinebuf()) {
+			alloc();
+			memcpy(x,ma.x,s*sizeof(double));
+		} else {
+			x = ma.x;
+			ma.m = ma.n = ma.s = 0;
+			ma.x = ma.inlinebuf();
+		}
+	}
+
 	int m,n,s;
 	double *x;
+	double sbuf[CM_INLINE+7];
+};
+
+// The LU factors of a square cmatrix, kept so that several right-hand
+// sides can be solved against one factorization.  A SOLVE_MIXED
+// factorization is single precision and refines each solve against the
+// original matrix, so that matrix must stay unchanged while it is used.
+class cmatrixlu {
+public:
+	cmatrixlu();
+	~cmatrixlu();
+
+	// factors a; returns false if a is singular
+	bool factor(const cmatrix &a, cmatrix::solvemode mode=cmatrix::SOLVE_DOUBLE);
+	// dest = inverse(a)*b; dest may be b.  Returns false only if a
+	// mixed solve failed to refine and a turned out to be singular.
+	bool solve(const cvector &b, cvector &dest);
+	bool solve(const double *b, double *dest);
+
+	// the determinant of a, and its sign (which survives even when
+	// the determinant of a large matrix overflows or underflows)
+	inline double det() const { return d; }
+	inline int detsign() const { return dsign; }
+	// the precision now in use: SOLVE_MIXED drops to SOLVE_DOUBLE
+	// once a refinement has failed
+	inline cmatrix::solvemode getmode() const { return mode; }
+
+private:
+	bool factorDouble();
+
+	const cmatrix *a;
+	int n, dsign;
+	cmatrix::solvemode mode;
+	double d;
+	float *lf; // single precision L\U, n x n
+	cmatrix ld; // double precision L\U
+	int *ix;
+	double *vv; // the row scale factors, while factoring
+};
+
+// A block diagonal projection, stored by its support rather than as a
+// dense matrix.  Block b covers indices off[b] to off[b+1]-1; within it
+// the projection takes the supported indices onto the plane where they
+// sum to zero and sends the others to zero.  This is the jacobian of
+// gnmgame::retract, and building or applying it costs time in the
+// supports rather than in the square of the dimension.
+class csupportproj {
+friend class cmatrix;
+public:
+	csupportproj();
+	~csupportproj();
+
+	// a projection of dimension off[nb], with the support marked by
+	// the nonzero entries of support
+	void set(int nb, const int *off, const int *support);
+
+	inline int getm() const { return m; }
+
+	// dest = P*source; dest may be source
+	void multiply(const cvector &source, cvector &dest) const;
+	// writes P out as a dense matrix
+	void dense(cmatrix &dest) const;
+
+private:
+	int m, nb, cap;
+	int *boff; // block b's supported indices are ix[boff[b]..boff[b+1]-1]
+	int *ix;
+	unsigned char *on; // on[i] is nonzero if i is supported
 };
 
 inline cmatrix operator+(const cmatrix &a, const cmatrix &b) {
-	return cmatrix(a)+=b;
+	if (a.getm()!=b.getm() || a.getn()!=b.getn()) {
+		cerr << "invalid cmatrix addition" << endl;
+		assert(0);
+	}
+	cmatrix ret(a.getm(),a.getn());
+	const double *av = a.values(), *bv = b.values();
+	double *rv = ret.values();
+	int s = a.getm()*a.getn();
+	for(int i=0;i<s;i++) rv[i] = av[i]+bv[i];
+	return ret;
 }
 inline cmatrix operator-(const cmatrix &a, const cmatrix &b) {
-	return cmatrix(a)-=b;
+	if (a.getm()!=b.getm() || a.getn()!=b.getn()) {
+		cerr << "invalid cmatrix subtraction" << endl;
+		assert(0);
+	}
+	cmatrix ret(a.getm(),a.getn());
+	const double *av = a.values(), *bv = b.values();
+	double *rv = ret.values();
+	int s = a.getm()*a.getn();
+	for(int i=0;i<s;i++) rv[i] = av[i]-bv[i];
+	return ret;
 }
 inline cmatrix operator+(const cmatrix &a, const double &b) {
-	return cmatrix(a)+=b;
+	cmatrix ret(a.getm(),a.getn());
+	const double *av = a.values();
+	double *rv = ret.values();
+	int s = a.getm()*a.getn();
+	for(int i=0;i<s;i++) rv[i] = av[i]+b;
+	return ret;
 }
 inline cmatrix operator-(const cmatrix &a, const double &b) {
-	return cmatrix(a)-=b;
+	return a+(-b);
 }
 inline cmatrix operator+(const double &a, const cmatrix &b) {
-	return cmatrix(b)+=a;
+	return b+a;
 }
 inline cmatrix operator-(const double &a, const cmatrix &b) {
-	return cmatrix(b.getn(),b.getm(),a)-=b;
+	cmatrix ret(b.getm(),b.getn());
+	const double *bv = b.values();
+	double *rv = ret.values();
+	int s = b.getm()*b.getn();
+	for(int i=0;i<s;i++) rv[i] = a-bv[i];
+	return ret;
 }
 inline cmatrix operator*(const cmatrix &a, const double &b) {
-	return cmatrix(a)*=b;
+	cmatrix ret(a.getm(),a.getn());
+	const double *av = a.values();
+	double *rv = ret.values();
+	int s = a.getm()*a.getn();
+	for(int i=0;i<s;i++) rv[i] = av[i]*b;
+	return ret;
 }
 inline cmatrix operator*(const double &b, const cmatrix &a) {
-	return cmatrix(a)*=b;
+	return a*b;
 }
 inline cmatrix operator/(const cmatrix &a, const double &b) {
-	return cmatrix(a)/=b;
+	cmatrix ret(a.getm(),a.getn());
+	const double *av = a.values();
+	double *rv = ret.values();
+	int s = a.getm()*a.getn();
+	for(int i=0;i<s;i++) rv[i] = av[i]/b;
+	return ret;
+}
+inline cmatrix operator+(cmatrix &&a, const cmatrix &b) {
+	return std::move(a+=b);
+}
+inline cmatrix operator-(cmatrix &&a, const cmatrix &b) {
+	return std::move(a-=b);
+}
+inline cmatrix operator+(cmatrix &&a, const double &b) {
+	return std::move(a+=b);
+}
+inline cmatrix operator-(cmatrix &&a, const double &b) {
+	return std::move(a-=b);
+}
+inline cmatrix operator*(cmatrix &&a, const double &b) {
+	return std::move(a*=b);
+}
+inline cmatrix operator/(cmatrix &&a, const double &b) {
+	return std::move(a/=b);
 }
 
 inline ostream& operator<<(ostream& s, const cmatrix& ma) {
@@ -874,12 +1239,7 @@ if (i%ma.n==0) s << endl; s << ma.x[i]; if (i!=ma.s) s << ' '; }
 inline istream& operator>>(istream& s, cmatrix& ma) {
 	int tn,tm;
 	s >> tm >> tn;
-	if (tm!=ma.m || tn!=ma.n) {
-		delete []ma.x;
-		ma.s = tm*tn;
-		ma.x = new double[ma.s];
-		ma.m = tm; ma.n = tn;
-	}
+	if (tm!=ma.m || tn!=ma.n) ma.reshape(tm,tn);
 	for(int i=0;i<ma.s;i++) { s >> ma.x[i]; }
 	return s;
 }
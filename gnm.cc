@@ -17,9 +17,14 @@
  * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "cmatrix.h"
 #include "gnm.h"
 #include "gnmgame.h"
+#include "threadpool.h"
 
 // gnm(A,g,Eq,steps,fuzz,LNMFreq,LNMMax,LambdaMin,wobble,threshold)
 // ----------------------------------------------------------------
@@ -27,6 +32,8 @@
 // Interpretation of parameters:
 // g: perturbation ray.
 // Eq: an array of equilibria will be stored here
+// fn, arg: in place of Eq, fn(arg, e, k) is called with the k-th
+//          equilibrium e as soon as it is found, and may stop the trace
 // steps: number of steps to take within a support cell; higher 
 //        values of this parameter slow GNM down, but may help it
 //        avoid getting off the path.
@@ -46,8 +53,275 @@
 // threshold: the equilibrium error threshold for doing a wobble.  If
 //            wobbles are disabled, GNM will terminate if the error
 //            reaches this threshold.
+// opts: further settings, described in gnm.h.
 
-int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold) {
+void gnmworkspace::resize(int N, int M) {
+  if(N == this->N && M == this->M)
+    return;
+  DG.reshape(M,M);
+  J.reshape(M,M);
+  I.reshape(M,M);
+  I = 0.0;
+  for(int i = 0; i < M; i++)
+    I[i][i] = 1.0;
+  sigma.resize(M);
+  g0.resize(M);
+  z.resize(M);
+  v.resize(M);
+  dz.resize(M);
+  dv.resize(M);
+  dzlast.resize(M);
+  zlast.resize(M);
+  nothing.resize(M);
+  nothing = 0.0;
+  err.resize(M);
+  backup.resize(M);
+  G.resize(N);
+  yn1.resize(N);
+  this->N = N;
+  this->M = M;
+}
+
+int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, const gnmopts &opts) {
+  gnmworkspace ws;
+  return GNM(A, g, Eq, steps, fuzz, LNMFreq, LNMMax, LambdaMin, wobble, threshold, ws, opts);
+}
+
+static int GNMrun(gnmgame &A, cvector &g, cvector **&Eq, gnmeqfn fn, void *arg, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts);
+
+// the number of steps of length dt it takes to go del, but at most most
+static int adaptSteps(double del, double dt, int most) {
+  if(most < 1)
+    return 1;
+  if(!(dt > 0.0) || del / dt >= most)
+    return most;
+  int n = (int)ceil(del / dt);
+  return n < 1 ? 1 : n;
+}
+
+// adds the LNM run recorded in ls to st
+static void lnmtally(gnmlnmstats *st, const lnmsearch &ls) {
+  if(!st)
+    return;
+  st->calls++;
+  st->converged += ls.converged;
+  st->iters += ls.iters;
+  st->halvings += ls.halvings;
+  if(ls.iters > 0 && ls.err[0] > 0.0 && ls.err[ls.iters] > 0.0)
+    st->reduction += log10(ls.err[ls.iters] / ls.err[0]);
+  if(st->hist)
+    st->hist[ls.iters]++;
+}
+
+// GNMrun with the work counted into opts.stats, if it is set
+static int GNMcount(gnmgame &A, cvector &g, cvector **&Eq, gnmeqfn fn, void *arg, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts) {
+  if(!opts.stats)
+    return GNMrun(A, g, Eq, fn, arg, steps, fuzz, LNMFreq, LNMMax, LambdaMin, wobble, threshold, ws, opts);
+  gtstats mark = gt_stats_mark();
+  int numEq = GNMrun(A, g, Eq, fn, arg, steps, fuzz, LNMFreq, LNMMax, LambdaMin, wobble, threshold, ws, opts);
+  gt_stats_since(mark, *opts.stats);
+  return numEq;
+}
+
+// Takes the snapshots of a gnmcheckpoint, and restores the path from them.
+struct gnmpath {
+  // makes ck ready for a call starting afresh, or from the snapshot in from
+  static void start(gnmcheckpoint &ck, const gnmcheckpoint *from) {
+    if(!from) {
+      ck.M = 0;
+      ck.numEq = 0;
+      ck.cells = 0;
+      ck.eq.clear();
+      return;
+    }
+    if(from != &ck) {
+      ck.N = from->N;
+      ck.M = from->M;
+      ck.Index = from->Index;
+      ck.s_hat_old = from->s_hat_old;
+      ck.numEq = from->numEq;
+      ck.cells = from->cells;
+      ck.lambda = from->lambda;
+      ck.z = from->z;
+      ck.g = from->g;
+      ck.sigma = from->sigma;
+      ck.dgat = from->dgat;
+      ck.eq = from->eq;
+      ck.B = from->B;
+      ck.s = from->s;
+    }
+    ck.eq.resize((size_t)ck.numEq * ck.M); // those found after it are found again
+  }
+
+  static void take(gnmcheckpoint &ck, int N, long cells, const cvector &z, const cvector &g, const cvector &sigma, const cvector &dgat, double lambda, const int *B, const int *s, int Index, int s_hat_old) {
+    int M = z.getm();
+    ck.N = N;
+    ck.M = M;
+    ck.numEq = ck.eq.size() / M;
+    ck.cells = cells;
+    ck.lambda = lambda;
+    ck.Index = Index;
+    ck.s_hat_old = s_hat_old;
+    ck.z.assign(z.values(), z.values() + M);
+    ck.g.assign(g.values(), g.values() + M);
+    ck.sigma.assign(sigma.values(), sigma.values() + M);
+    ck.dgat.assign(dgat.values(), dgat.values() + M);
+    ck.B.assign(B, B + M);
+    ck.s.assign(s, s + ck.N);
+  }
+
+  static void found(gnmcheckpoint &ck, const cvector &e) {
+    ck.eq.insert(ck.eq.end(), e.values(), e.values() + e.getm());
+  }
+
+  static int count(const gnmcheckpoint &ck) { return ck.numEq; }
+
+  static void equilibrium(const gnmcheckpoint &ck, int k, cvector &e) {
+    for(int i = 0; i < ck.M; i++)
+      e[i] = ck.eq[(size_t)k*ck.M + i];
+  }
+
+  // returns 0 if ck is not of a game shaped as A
+  static int restore(const gnmcheckpoint &ck, gnmgame &A, cvector &z, cvector &g, cvector &sigma, cvector &dgat, double &lambda, int *B, int *s, int &Index, int &s_hat_old, long &cells) {
+    if(ck.N != A.getNumPlayers() || ck.M != A.getNumActions())
+      return 0;
+    for(int i = 0; i < ck.M; i++) {
+      z[i] = ck.z[i];
+      g[i] = ck.g[i];
+      sigma[i] = ck.sigma[i];
+      dgat[i] = ck.dgat[i];
+      B[i] = ck.B[i];
+    }
+    for(int n = 0; n < ck.N; n++)
+      s[n] = ck.s[n];
+    lambda = ck.lambda;
+    Index = ck.Index;
+    s_hat_old = ck.s_hat_old;
+    cells = ck.cells;
+    return 1;
+  }
+};
+
+// The blob is a header of "GTCK", the version and the int fields, then
+// cells, lambda, the vectors and B as bytes, and a checksum of it all.
+#define CKVERSION 1
+
+// FNV-1a over len bytes at p, continuing from h
+static uint64_t ckhash(uint64_t h, const char *p, size_t len) {
+  for(size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static void ckput(std::vector<char> &buf, const void *p, size_t len) {
+  buf.insert(buf.end(), (const char *)p, (const char *)p + len);
+}
+
+void gnmcheckpoint::save(std::vector<char> &buf) const {
+  int32_t head[7] = { CKVERSION, N, M, Index, s_hat_old, numEq, 0 };
+  int64_t c = cells;
+  buf.clear();
+  ckput(buf, "GTCK", 4);
+  ckput(buf, head, sizeof(head));
+  ckput(buf, &c, sizeof(c));
+  ckput(buf, &lambda, sizeof(lambda));
+  ckput(buf, &z[0], M * sizeof(double));
+  ckput(buf, &g[0], M * sizeof(double));
+  ckput(buf, &sigma[0], M * sizeof(double));
+  ckput(buf, &dgat[0], M * sizeof(double));
+  for(int i = 0; i < M; i++)
+    buf.push_back((char)(B[i] != 0));
+  for(int n = 0; n < N; n++) {
+    int32_t x = s[n];
+    ckput(buf, &x, sizeof(x));
+  }
+  if(numEq)
+    ckput(buf, &eq[0], (size_t)numEq * M * sizeof(double));
+  uint64_t h = ckhash(0xcbf29ce484222325ULL, &buf[0], buf.size());
+  ckput(buf, &h, sizeof(h));
+}
+
+int gnmcheckpoint::load(const char *buf, size_t len) {
+  int32_t head[7];
+  size_t at = 4 + sizeof(head);
+  if(len < at + sizeof(uint64_t) || memcmp(buf, "GTCK", 4) != 0)
+    return 0;
+  memcpy(head, buf + 4, sizeof(head));
+  int n = head[1], m = head[2], ne = head[5];
+  if(head[0] != CKVERSION || n < 1 || m < n || ne < 0 || (size_t)m > len || (size_t)ne * m > len)
+    return 0;
+  size_t need = at + sizeof(int64_t) + sizeof(double) + 4 * (size_t)m * sizeof(double)
+    + m + n * sizeof(int32_t) + (size_t)ne * m * sizeof(double);
+  uint64_t h;
+  if(len != need + sizeof(h))
+    return 0;
+  memcpy(&h, buf + need, sizeof(h));
+  if(h != ckhash(0xcbf29ce484222325ULL, buf, need))
+    return 0;
+
+  int64_t c;
+  N = n;
+  M = m;
+  Index = head[3];
+  s_hat_old = head[4];
+  numEq = ne;
+  memcpy(&c, buf + at, sizeof(c));
+  cells = (long)c;
+  at += sizeof(c);
+  memcpy(&lambda, buf + at, sizeof(lambda));
+  at += sizeof(lambda);
+  std::vector<double> *v[4] = { &z, &g, &sigma, &dgat };
+  for(int k = 0; k < 4; k++) {
+    v[k]->resize(m);
+    memcpy(&(*v[k])[0], buf + at, m * sizeof(double));
+    at += m * sizeof(double);
+  }
+  B.resize(m);
+  for(int i = 0; i < m; i++)
+    B[i] = buf[at++];
+  s.resize(n);
+  for(int i = 0; i < n; i++) {
+    int32_t x;
+    memcpy(&x, buf + at, sizeof(x));
+    s[i] = x;
+    at += sizeof(x);
+  }
+  eq.resize((size_t)ne * m);
+  if(ne)
+    memcpy(&eq[0], buf + at, (size_t)ne * m * sizeof(double));
+  return 1;
+}
+
+int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts) {
+  return GNMcount(A, g, Eq, 0, 0, steps, fuzz, LNMFreq, LNMMax, LambdaMin, wobble, threshold, ws, opts);
+}
+
+int GNM(gnmgame &A, cvector &g, gnmeqfn fn, void *arg, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts) {
+  cvector **Eq = 0; // not used
+  return GNMcount(A, g, Eq, fn, arg, steps, fuzz, LNMFreq, LNMMax, LambdaMin, wobble, threshold, ws, opts);
+}
+
+// adds a record of an event on the path to tr, if it is set
+static inline void gnmnote(gnmtrace *tr, gnmtracekind kind, long cell, int step, int action, int index, double lambda, double dlambda, double delta, double err0, double err1) {
+  if(!tr)
+    return;
+  gnmtracerec r;
+  r.cell = cell;
+  r.kind = kind;
+  r.step = step;
+  r.action = action;
+  r.index = index;
+  r.lambda = lambda;
+  r.dlambda = dlambda;
+  r.delta = delta;
+  r.err0 = err0;
+  r.err1 = err1;
+  tr->record(r);
+}
+
+static int GNMrun(gnmgame &A, cvector &g, cvector **&Eq, gnmeqfn fn, void *arg, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts) {
   int i, // utility variables
     bestAction,  
     k, 
@@ -58,7 +332,15 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
     s_hat, // the next pure strategy to enter or leave the support
     Index = 1, // index of the equilibrium we're moving towards
     numEq = 0, // number of equilibria found so far
-    stepsLeft; // number of linear steps remaining until we hit the boundary
+    stepsLeft, // number of linear steps remaining until we hit the boundary
+    adapt, // whether steps are sized as we go
+    maxSteps = opts.minstep > 0.0 ? (int)ceil(1.0 / opts.minstep) : steps,
+    haslast = 0, // whether the tangent of the last step in this cell is kept
+    keeplast = opts.turn > 0.0 || opts.predictor != gnmopts::PREDICT_EULER,
+    bent = 0, // whether the last step took the Hermite term
+    sized = 0, // whether dt is set
+    taken, // steps taken in this cell
+    cellsteps; // the same, for opts.trace, counting those taken again
 
   int N = A.getNumPlayers(), 
     M = A.getNumActions(); // the two most important cvector sizes, stored locally for brevity
@@ -74,6 +356,12 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
     delta, // the actual amount of time we will step forward (smaller than del)
     x0,
     ee,
+    arc = 0.0, // length of the last step in (z,lambda)
+    tlen = 0.0, tlast = 0.0, // lengths of the tangent now and at the last step
+    dlast = 0.0, // dlambda at the last step
+    hlast = 0.0, // and its delta
+    dt = 0.0, // with adapt, the step that would turn the path by opts.turn
+    lastlambda = 0.0, // lambda before the last step
     V = 0.0; // scale factor for perturbation
 
   int s[M]; // current best responses
@@ -81,78 +369,131 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
 
   memset(B, 0, M * sizeof(int));
 
-  cmatrix DG(M,M), // jacobian of the payoff function
-    R(M,M), // jacobian of the retraction operator
-    I(M,M,1,1), // identity
-    Dpsi, // jacobian of the cvector field
-    J(M,M); // adjoint of Dpsi
+  ws.resize(N,M);
+  cmatrix &DG = ws.DG, // jacobian of the payoff function
+    &I = ws.I, // identity
+    &J = ws.J; // adjoint of the jacobian of the vector field
+  csupportproj &R = ws.R; // jacobian of the retraction operator
+
+  cvector &sigma = ws.sigma, // current strategy profile
+    &g0 = ws.g0, // original perturbation ray
+    &z = ws.z, // current position in space of games
+    &v = ws.v, // current cvector of payoffs for each pure strategy
+    &dz = ws.dz, // derivative of z w.r.t. time
+    &dv = ws.dv, // derivative of v w.r.t. time
+    &nothing = ws.nothing,// cvector of all zeros
+    &err = ws.err, // error in the equilibrium equations; also scratch space
+    &backup = ws.backup; // scratch space for LNM
+
 
-  cvector sigma(M), // current strategy profile
-    g0(M), // original perturbation ray
-    z(M), // current position in space of games
-    v(M), // current cvector of payoffs for each pure strategy
-    dz(M), // derivative of z w.r.t. time
-    dv(M), // derivative of v w.r.t. time
-    nothing(M,0),// cvector of all zeros
-    err(M),
-    backup(M); 
+  // with opts.solve == SOLVE_MIXED, the factorization of the jacobian
+  // that replaces J; factored is set while it is valid for the current J
+  cmatrixlu &Jlu = ws.Jlu;
+  int factored = 0;
+
+  // room for LNM's Broyden updates, if it is to make them
+  cmatrix *Wp = 0;
+  if(opts.broyden && LNMMax >= 1) {
+    ws.W.reshape(2*LNMMax+1, M);
+    Wp = &ws.W;
+  }
 
+  // counts the steps against opts.control
+  gtbudget budget(opts.control);
+
+  // the equilibria found, if only new ones are to be stored
+  eqset uniq(opts.unique > 0.0 ? M : 0, opts.unique), *found = 0;
+  if(opts.unique > 0.0)
+    found = &uniq;
+
+  // the line search and record for LNM, if either is wanted
+  lnmsearch lsx, *ls = 0;
+  double lnmerr[LNMMax > 0 ? LNMMax+1 : 1];
+  if(opts.backtrack > 0 || opts.lnm) {
+    lsx.backtrack = opts.backtrack;
+    lsx.err = lnmerr;
+    ls = &lsx;
+  }
 
   // utility variables for use as intermediate values in computations
-  cmatrix Y1(M,M), Y2(M,M), Y3(M,M);
-  cvector G(N), yn1(N), ym1(M), ym2(M), ym3(M);
+  cvector &G = ws.G, &yn1 = ws.yn1;
+
+  // where the path starts: afresh from g, or from a snapshot
+  const gnmcheckpoint *from = opts.resume && opts.resume->valid() ? opts.resume : 0;
+  gnmcheckpoint *ck = opts.checkpoint;
+  long cells = 0; // cells entered, counting those before a resume
+  int dgerr = 0; // whether DG was last taken at err, rather than at sigma
 
   // INITIALIZATION
-  Eq = (cvector **)malloc(sizeof(cvector *));
+  if(!fn)
+    Eq = (cvector **)malloc(sizeof(cvector *));
 
-  // Find the lone equilibrium of the perturbed game
-  for(n = 0; n < N; n++) {
-    bestPayoff = g[A.firstAction(n)];
-    bestAction = A.firstAction(n);
-    for(j = bestAction+1; j < A.lastAction(n); j++) {
-      if(g[j] > bestPayoff) {
-	bestPayoff = g[j];
-	bestAction = j;
+  if(from) { // carry on from the snapshot
+    if(!gnmpath::restore(*from, A, z, g, sigma, err, lambda, B, s, Index, s_hat_old, cells))
+      return numEq; // it is of another game
+    A.payoffMatrix(DG, err, fuzz); // where the path had last taken it
+    dgerr = 1;
+    for(k = 0; k < gnmpath::count(*from); k++) {
+      gnmpath::equilibrium(*from, k, backup);
+      if(found)
+	found->insert(backup);
+      if(!fn) {
+	Eq = (cvector **)realloc(Eq, (numEq+2)*sizeof(cvector *));
+	Eq[numEq] = new cvector(M);
+	*(Eq[numEq]) = backup;
       }
+      numEq++;
+    }
+  } else {
+    // Find the lone equilibrium of the perturbed game
+    for(n = 0; n < N; n++) {
+      bestPayoff = g[A.firstAction(n)];
+      bestAction = A.firstAction(n);
+      for(j = bestAction+1; j < A.lastAction(n); j++) {
+	if(g[j] > bestPayoff) {
+	  bestPayoff = g[j];
+	  bestAction = j;
+	}
+      }
+      s[n] = bestAction;
+      B[bestAction] = 1;
+      G[n] = bestPayoff;
     }
-    s[n] = bestAction;
-    B[bestAction] = 1;
-    G[n] = bestPayoff;
-  }
 
-  // initialize sigma to be the pure strategy profile
-  // that is the lone equilibrium of the perturbed game
-  for(i = 0; i < M; i++)
-    sigma[i] = (double)B[i];
+    // initialize sigma to be the pure strategy profile
+    // that is the lone equilibrium of the perturbed game
+    for(i = 0; i < M; i++)
+      sigma[i] = (double)B[i];
 
-  A.payoffMatrix(DG, sigma, fuzz);
-  DG.multiply(sigma, v);
-  v /= (double)(N-1);
+    A.payoffMatrix(DG, sigma, fuzz);
+    DG.multiply(sigma, v);
+    v /= (double)(N-1);
 
-  // Scale g until the equilibrium sigma calculated above
-  // is in fact the one unique equilibrium, and set lambda
-  // equal to 1
+    // Scale g until the equilibrium sigma calculated above
+    // is in fact the one unique equilibrium, and set lambda
+    // equal to 1
 
-  V = 0;
+    V = 0;
 
-  for(n = 0; n < N; n++) {
-    yn1[n] = v[s[n]];
-    for(i = A.firstAction(n); i < A.lastAction(n); i++) {
-      if(!B[i]) {
-        if(G[n] == g[i]) {
-          if(v[i] > yn1[n]) return numEq; // degenerate perturbation
-          continue;
-        }
-        newV = (v[i]-yn1[n]) / (G[n]-g[i]);
-        if(newV > V) 
-          V = newV;
+    for(n = 0; n < N; n++) {
+      yn1[n] = v[s[n]];
+      for(i = A.firstAction(n); i < A.lastAction(n); i++) {
+	if(!B[i]) {
+	  if(G[n] == g[i]) {
+	    if(v[i] > yn1[n]) return numEq; // degenerate perturbation
+	    continue;
+	  }
+	  newV = (v[i]-yn1[n]) / (G[n]-g[i]);
+	  if(newV > V) 
+	    V = newV;
+	}
       }
     }
-  }
        
-  lambda = 1.0;  // we scale g instead
-  V = V+1; // a little extra padding
-  g *= V;
+    lambda = 1.0;  // we scale g instead
+    V = V+1; // a little extra padding
+    g *= V;
+  }
 /*
   for(n = 0; n < N; n++) {
     yn1[n] = v[s[n]]; // yn1[n] is the payoff n receives for the action we wish to make dominant
@@ -178,22 +519,36 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
     steps = 1;
   }
 
-  z = g;
-  z += v;
-  z += sigma;
+  if(ck)
+    gnmpath::start(*ck, from);
+  if(!from)
+    z = g + v + sigma;
   //  z=sigma+v+g*lambda;
 
   A.retractJac(R,B);
 
   // this outer while loop executes once for each support boundary
   // that the path crosses.
-  while(1) {
+  for(int cell = 0; ; cell++) {
+    if(cell > 0 && !budget.support())
+      return numEq;
+    if(ck && ((ck->every > 0 && cells % ck->every == 0) || ck->request.exchange(0))) {
+      gnmpath::take(*ck, N, cells, z, g, sigma, dgerr ? err : sigma, lambda, B, s, Index, s_hat_old);
+      if(ck->fn)
+	ck->fn(ck->arg, *ck);
+    }
+    cells++;
     minBound = BIGFLOAT;
     k = 0; // iteration counter; when k reaches LNMFreq, run LNM
+    adapt = opts.turn > 0.0 && N > 2;
+    haslast = sized = taken = cellsteps = 0; // the path has a corner at the boundary
      // within a single boundary, support unchanged
 
     // take the specified number of steps within these support boundaries.  
     for(stepsLeft = steps; stepsLeft > 0; stepsLeft--) { 
+      if((opts.stop && opts.stop->load()) || !budget.step())
+	return numEq;
+
       //find J = Adj psi
       J = I;
       J += DG;
@@ -201,27 +556,45 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
       J -= I;
       J.negate();
       // J = I-((I+DG)*R);
-      det = J.adjoint(); // sets J = adjoint(J)
 
-      // find derivatives of z and lambda
-      J.multiply(g,dz);
-      dz.negate();      
+      // find derivatives of z and lambda.  A mixed solve gives
+      // J^-1 g, which is adjoint(J) g scaled by 1/det; scaling the
+      // direction by 1/|det| instead leaves the path unchanged.
+      factored = opts.solve == cmatrix::SOLVE_MIXED
+	&& Jlu.factor(J, opts.solve) && Jlu.solve(g, dz);
+      if(factored) {
+	det = Jlu.detsign();
+	dz *= -det;
+      } else {
+	det = J.adjoint(); // sets J = adjoint(J)
+	J.multiply(g,dz);
+	dz.negate();      
+      }
        //dz = -(J*g);
       dlambda = -det;
-      R.multiply(dz, ym1);
-      DG.multiply(ym1,dv);
-      //dv = (DG*(R*dz));
-      ym1 = g;
-      ym1 *= dlambda;
-      dv += ym1;
-      //dv += g*dlambda;
+
+      // With adapt, a step is as long as the one before, scaled by
+      // how far the tangent (dz,dlambda) turned over it against
+      // opts.turn: a straight path takes long steps, a bending one
+      // short.  The first step in a cell covers 1/steps of the way.
+      if(adapt) {
+	tlen = sqrt(dz.norm2() + dlambda*dlambda);
+	if(haslast && tlen > 0.0 && tlast > 0.0) {
+	  x0 = (dz * ws.dzlast + dlambda * dlast) / (tlen * tlast);
+	  x0 = acos(x0 > 1.0 ? 1.0 : x0 < -1.0 ? -1.0 : x0);
+	  x0 = x0 > opts.turn / 4.0 ? opts.turn / x0 : 4.0;
+	  dt = arc * (x0 < 0.25 ? 0.25 : x0) / tlen;
+	  sized = 1;
+	}
+      }
+      R.multiply(dz, err);
+      DG.multiply(err,dv);
+      dv += g*dlambda;
+      //dv = (DG*(R*dz)) + g*dlambda;
       
       //Calculate payoff cvector
       DG.multiply(sigma, v);      
-      v /=  (double)(N-1);
-      ym1 = g;
-      ym1 *= lambda;
-      v += ym1;
+      v = v / (double)(N-1) + g*lambda;
       // v = DG*sigma / (double)(N-1) + g * lambda;
       
       //Find next action that will enter or leave the support
@@ -258,6 +631,8 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
       }
       
       // each step covers 1.0/steps of the distance to the boundary
+      if(adapt && sized)
+	stepsLeft = adaptSteps(del, dt, maxSteps - taken);
       delta = del / stepsLeft;
          
       // test whether lambda will become 0 in the course of this
@@ -266,15 +641,14 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
         if (dlambda == 0.0) return numEq;
 	// if there's no next support boundary, treat the equilibrium
 	// as the next support boundary and step up to it incrementally
+	if(adapt && sized && minBound == BIGFLOAT)
+	  stepsLeft = adaptSteps(-lambda / dlambda, dt, maxSteps - taken);
 	if(minBound == BIGFLOAT && N > 2 && stepsLeft > 1) { 
 	  del = -lambda / dlambda;
 	  delta = del / stepsLeft;
 	} else {
 	  delta -= -lambda / dlambda; // delta is now just big enough
-	  ym1 = dz;                   // to get us to the equilibrium
-	  ym1 *= (-lambda / dlambda); 
-	  z += ym1;
-	  //  z += dz*delta;
+	  z += dz*(-lambda / dlambda); // to get us to the equilibrium
 	  lambda = 0;
 	  A.retract(sigma, z);
 	  A.payoffMatrix(DG, sigma, fuzz);
@@ -287,14 +661,37 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
 	    J -= I; 
 	    J.negate();
 	    //J=I-((I+DG)*R);
-	    det = J.adjoint();
-	    ee = A.LNM(z, nothing, det, J, DG, sigma, LNMMax, fuzz,ym1,ym2,ym3);
+	    factored = opts.solve == cmatrix::SOLVE_MIXED
+	      && Jlu.factor(J, opts.solve);
+	    if(factored)
+	      ee = A.LNM(z, nothing, Jlu, DG, sigma, LNMMax, fuzz,err,dv,backup,Wp,ls);
+	    else {
+	      det = J.adjoint();
+	      ee = A.LNM(z, nothing, det, J, DG, sigma, LNMMax, fuzz,err,dv,backup,Wp,ls);
+	    }
+	    if(ls)
+	      lnmtally(opts.lnm, lsx);
 	  }
-	  if(ee < fuzz) { // only save high quality equilibria;
-	    // this restriction could be removed.
-	    Eq = (cvector **)realloc(Eq, (numEq+2)*sizeof(cvector *));	
-	    Eq[numEq] = new cvector(M);
-	    *(Eq[numEq++]) = sigma;
+	  // only save high quality equilibria (this restriction could
+	  // be removed), and with opts.unique, only new ones
+	  i = ee < fuzz && (!found || found->insert(sigma));
+	  gnmnote(opts.trace, GNM_TR_EQ, cells, cellsteps, i, Index, lambda, dlambda, 0.0, 0.0, ee);
+	  if(i) {
+	    if(ck)
+	      gnmpath::found(*ck, sigma);
+	    if(fn) {
+	      numEq++;
+	      if(opts.stop && opts.stopfirst)
+		opts.stop->store(1);
+	      if(!fn(arg, sigma, numEq))
+		return numEq;
+	    } else {
+	      Eq = (cvector **)realloc(Eq, (numEq+2)*sizeof(cvector *));	
+	      Eq[numEq] = new cvector(M);
+	      *(Eq[numEq++]) = sigma;
+	      if(opts.stop && opts.stopfirst)
+		opts.stop->store(1);
+	    }
 	  }
 	  Index = -Index;
 	  s_hat_old = -1;
@@ -306,14 +703,54 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
 	return numEq;
       }
 
-      backup = z;
-
       // do the step
-      ym1 = dz;
-      ym1 *= delta;
-      z += ym1;
-      // z = z+dz*delta;
-      lambda += dlambda*delta;
+      cellsteps++;
+      if(adapt) {
+	ws.zlast = z;
+	lastlambda = lambda;
+	taken++;
+      }
+      // The Hermite predictor adds the second order term, taking the
+      // derivative of the tangent from its change over the last step.
+      // Steps onto a boundary stay linear, as their length assumes,
+      // as do those where the tangent has turned right around, and
+      // those that would bend past the equilibrium or past a support
+      // boundary that the linear step stops short of.
+      bent = 0;
+      if(haslast && stepsLeft > 1 && opts.predictor == gnmopts::PREDICT_HERMITE
+	 && dz * ws.dzlast + dlambda * dlast > 0.0) {
+	x0 = delta * delta / (2.0 * hlast);
+	bent = Index*(lambda + dlambda*delta + (dlambda - dlast)*x0) > 0.0;
+	err = dz*delta;
+	err += z;
+	backup = dz;
+	backup -= ws.dzlast;
+	err += backup*x0;
+	for(n = 0; n < N && bent; n++) {
+	  for(i = A.firstAction(n); i < A.lastAction(n); i++) {
+	    newV = v[s[n]] + dv[s[n]]*delta;
+	    if(i != s_hat_old && (err[i] > newV) != (z[i] > v[s[n]])) {
+	      bent = 0;
+	      break;
+	    }
+	  }
+	}
+      }
+      if(bent) {
+	z = err;
+	lambda += dlambda*delta + (dlambda - dlast)*x0;
+      } else {
+	z += dz*delta;
+	lambda += dlambda*delta;
+      }
+      if(keeplast) {
+	arc = delta * tlen;
+	ws.dzlast = dz;
+	dlast = dlambda;
+	hlast = delta;
+	tlast = tlen;
+	haslast = 1;
+      }
 
       // if we're sufficiently far out on the ray in the reverse
       // direction, we're probably not going back
@@ -323,39 +760,61 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
       A.retract(sigma,z);
       A.payoffMatrix(DG, sigma,fuzz);
       
-      if(N <= 2) 
+      if(N <= 2) {
+	gnmnote(opts.trace, GNM_TR_STEP, cells, cellsteps, bent, Index, lambda, dlambda, delta, 0.0, 0.0);
 	break; // already at the support boundary
+      }
       
       DG.multiply(sigma,err);
-      err /= (double)(N-1);
-      g0 = g;
-      g0 *= lambda;
-      err += g0;
-      err += sigma;
-      err -= z;
-      err.negate();
+      g0 = g*lambda;
+      err = -(err / (double)(N-1) + g0 + sigma - z);
       ee = max(err.max(),-err.min());
-      if(ee < fuzz && stepsLeft > 2) { // path is probably near-linear;
+      gnmnote(opts.trace, GNM_TR_STEP, cells, cellsteps, bent, Index, lambda, dlambda, delta, 0.0, ee);
+      // (a bent step says nothing of that)
+      if(ee < fuzz && stepsLeft > 2 && !bent) { // path is probably near-linear;
        	stepsLeft = 2;                 // step all the way to boundary
+	adapt = 0;                     // (in this cell, whatever the turn)
 	k = LNMFreq - 1;               // then run LNM
       }
+      // with adapt, a step that leaves the path is taken again at a
+      // quarter of the length, down to the shortest allowed
+      if(adapt && ee > threshold && taken < maxSteps) {
+	z = ws.zlast;
+	lambda = lastlambda;
+	A.retract(sigma, z);
+	A.payoffMatrix(DG, sigma, fuzz);
+	gnmnote(opts.trace, GNM_TR_RETRY, cells, cellsteps, 0, Index, lambda, dlambda, delta, 0.0, ee);
+	dt = delta / 4.0;
+	haslast = 0;
+	sized = 1;
+	stepsLeft++;
+	continue;
+      }
       if(ee > threshold) { // if we've accumulated too much error, either
 	if(wobble) {       // wobble or quit.
 	  if(lambda == 0.0) return numEq;
-	  DG.multiply(sigma, ym1);
-	  ym1 /= (double)(N-1);
-	  g = z;
-	  g -= sigma;
-	  g -= ym1;
-	  g /= lambda;
-	  // g = ((z-sigma)-((DG*sigma) / (double)(N-1)))/lambda;
+	  DG.multiply(sigma, err);
+	  g = (z - sigma - err / (double)(N-1)) / lambda;
+	  gnmnote(opts.trace, GNM_TR_WOBBLE, cells, cellsteps, 0, Index, lambda, dlambda, 0.0, ee, 0.0);
 	} else 
 	  return numEq;
       }
 
       // if we've done LNMMax repetitions, time to get back on the path
-      if(stepsLeft > 1 && (++k == LNMFreq)) {
-	A.LNM(z, g0, det, J, DG, sigma, LNMMax, fuzz,ym1,ym2,ym3);
+      // (with adapt, after every step; a predictor-corrector)
+      if(stepsLeft > 1 && (++k == LNMFreq || adapt)) {
+	if(factored)
+	  newV = A.LNM(z, g0, Jlu, DG, sigma, LNMMax, fuzz,err,dv,backup,Wp,ls);
+	else
+	  newV = A.LNM(z, g0, det, J, DG, sigma, LNMMax, fuzz,err,dv,backup,Wp,ls);
+	if(ls)
+	  lnmtally(opts.lnm, lsx);
+	if(opts.trace) { // LNM returns the error before its last step
+	  DG.multiply(sigma,err);
+	  err = -(err / (double)(N-1) + g0 + sigma - z);
+	  newV = max(err.max(),-err.min());
+	  gnmnote(opts.trace, GNM_TR_LNM, cells, cellsteps, ls ? lsx.iters : -1, Index, lambda, dlambda, 0.0, ee, newV);
+	}
 	k = 0;
       }
     } // end of for loop
@@ -373,29 +832,297 @@ int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFr
 	  break;
 	}
     B[s_hat] = !B[s_hat];
+    gnmnote(opts.trace, B[s_hat] ? GNM_TR_ENTER : GNM_TR_LEAVE, cells, cellsteps, s_hat, Index, lambda, dlambda, 0.0, 0.0, 0.0);
     A.retractJac(R,B);
     s_hat_old = s_hat;
-    A.retract(ym1, z);
-    sigma = ym1;
+    A.retract(err, z);
+    sigma = err;
     sigma.support(B);
     sigma.unfuzz(fuzz);
     A.normalizeStrategy(sigma);
-    z -= ym1;
-    z += sigma;
-    // z = (z-x)+sigma;
+    z = z - err + sigma;
+    // z = (z-x)+sigma, where x = err is the retraction of z
+    dgerr = 1; // DG is still that at err
      
     // wobble the perturbation cvector to put us back on an equilibrium
     if(N > 2 && wobble && lambda != 0.0) {
       A.payoffMatrix(DG, sigma, fuzz);
-      DG.multiply(sigma, ym1);
-      ym1 /= (double)(N-1);
-      g = z;
-      g -= sigma;
-      g -= ym1;
-      g /= lambda;
-      // g = ((z-sigma)-((DG*sigma) / (double)(N-1)))/lambda;
+      dgerr = 0;
+      DG.multiply(sigma, err);
+      g = (z - sigma - err / (double)(N-1)) / lambda;
+      gnmnote(opts.trace, GNM_TR_WOBBLE, cells, cellsteps, 0, Index, lambda, dlambda, 0.0, 0.0, 0.0);
+    }
+  }
+  return numEq;
+}
+
+// a fixed pseudo-random 64-bit value for each x (splitmix64)
+static inline uint64_t eqhash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// the part of a key for projection bucket b
+static inline uint64_t bucketKey(long long b) {
+  return eqhash((uint64_t)b * 2 + 1);
+}
+
+// the most entries near the support cutoff that find tries both ways;
+// past that it looks through everything
+#define EQAMBIG 10
+
+eqset::eqset(int M, double tol) : M(M), count(0), tol(tol), proj(M) {
+  double sum = 0.0;
+  for(int i = 0; i < M; i++) {
+    proj[i] = 0.5 + (eqhash(2*i+1) >> 11) * (1.0 / 9007199254740992.0);
+    sum += proj[i];
+  }
+  // the projections of equilibria within tol differ by at most
+  // tol*sum, so they are in the same bucket or next to each other
+  width = tol * sum;
+  if(!(width > 0.0))
+    width = 1.0;
+}
+
+// The key of e's support, an xor of a value for each action in it;
+// amb gets the actions within tol of the cutoff.
+uint64_t eqset::supportKey(const cvector &e, int *amb, int &namb) const {
+  uint64_t key = 0;
+  namb = 0;
+  for(int i = 0; i < M; i++) {
+    if(e[i] > 2.0*tol)
+      key ^= eqhash(2*i);
+    if(fabs(e[i] - 2.0*tol) <= tol) {
+      if(namb < EQAMBIG)
+	amb[namb] = i;
+      namb++;
+    }
+  }
+  return key;
+}
 
+long long eqset::bucket(const cvector &e) const {
+  double x = 0.0;
+  for(int i = 0; i < M; i++)
+    x += proj[i] * e[i];
+  return (long long)floor(x / width);
+}
+
+// the index of one filed under key within tol of e, or -1
+int eqset::match(uint64_t key, const cvector &e) const {
+  std::pair<std::unordered_multimap<uint64_t, int>::const_iterator,
+    std::unordered_multimap<uint64_t, int>::const_iterator> r = index.equal_range(key);
+  for(; r.first != r.second; ++r.first) {
+    const double *x = get(r.first->second);
+    int i;
+    for(i = 0; i < M; i++)
+      if(fabs(x[i] - e[i]) > tol)
+	break;
+    if(i == M)
+      return r.first->second;
+  }
+  return -1;
+}
+
+int eqset::find(const cvector &e) const {
+  int amb[EQAMBIG], namb, i, k;
+  uint64_t key = supportKey(e, amb, namb);
+  long long b = bucket(e);
+
+  if(namb > EQAMBIG) {
+    for(k = 0; k < count; k++) {
+      const double *x = get(k);
+      for(i = 0; i < M; i++)
+	if(fabs(x[i] - e[i]) > tol)
+	  break;
+      if(i == M)
+	return k;
+    }
+    return -1;
+  }
+  // each way of putting the ambiguous actions in or out of the support
+  for(int flip = 0; flip < (1 << namb); flip++) {
+    uint64_t sk = key;
+    for(i = 0; i < namb; i++)
+      if(flip & (1 << i))
+	sk ^= eqhash(2*amb[i]);
+    for(long long d = -1; d <= 1; d++)
+      if((k = match(sk ^ bucketKey(b + d), e)) >= 0)
+	return k;
+  }
+  return -1;
+}
+
+int eqset::insert(const cvector &e) {
+  int amb[EQAMBIG], namb;
+  if(find(e) >= 0)
+    return 0;
+  uint64_t key = supportKey(e, amb, namb);
+  key ^= bucketKey(bucket(e));
+  pts.insert(pts.end(), e.values(), e.values() + M);
+  index.insert(std::make_pair(key, count));
+  count++;
+  return 1;
+}
+
+// One path of GNMrays, with what it found and the work it did.
+struct gnmray {
+  cvector **Eq;
+  int numEq;
+  gtstats st;
+  gnmlnmstats lnm;
+  gtcontrol ctl; // its share of opts.control
+};
+
+static void addStats(gtstats &dest, const gtstats &st) {
+  dest.allocs += st.allocs;
+  dest.allocbytes += st.allocbytes;
+  dest.curbytes += st.curbytes;
+  dest.peakbytes += st.peakbytes; // the rays may hold theirs at once
+  for(int k = 0; k < GT_NKERNELS; k++) {
+    dest.kernel[k].calls += st.kernel[k].calls;
+    dest.kernel[k].flops += st.kernel[k].flops;
+    dest.kernel[k].bytes += st.kernel[k].bytes;
+  }
+}
+
+int GNMrays(gnmgame &A, cvector *g, int rays, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, const gnmopts &opts, const gnmraysopts &ropts) {
+  int r, k, numEq = 0, hlen = LNMMax > 0 ? LNMMax+1 : 1;
+  std::atomic<int> stop(0); // the rays' own, so that opts.stop is only read
+  gnmopts o = opts;
+  o.stop = &stop;
+  o.stopfirst = ropts.first;
+
+  gnmray *R = new gnmray[rays];
+  gtcontrol *C = opts.control;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  long *hist = 0;
+  if(opts.lnm && opts.lnm->hist)
+    hist = new long[rays * hlen];
+  for(r = 0; r < rays; r++) {
+    R[r].Eq = 0;
+    R[r].numEq = 0;
+    memset(&R[r].st, 0, sizeof(gtstats));
+    if(C) { // each ray counts its own steps against the limits
+      R[r].ctl = *C;
+      R[r].ctl.status = GT_RUN_DONE;
+      R[r].ctl.steps = R[r].ctl.supports = R[r].ctl.iters = 0;
+    }
+    if(hist) {
+      R[r].lnm.hist = hist + r*hlen;
+      for(k = 0; k < hlen; k++)
+	R[r].lnm.hist[k] = 0;
+    }
+  }
+
+  // the deadline and opts.stop are watched by a thread of its own,
+  // which sets the rays' stop flag if the rays are not done by the
+  // deadline, or opts.stop is set first; opts.stop is looked at every
+  // 10ms
+  std::mutex lock;
+  std::condition_variable wake;
+  int done = 0;
+  std::thread watch;
+  if(ropts.deadline > 0.0 || opts.stop)
+    watch = std::thread([&]() {
+	std::chrono::steady_clock::time_point end = t0
+	  + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(ropts.deadline));
+	std::unique_lock<std::mutex> lk(lock);
+	while(!done) {
+	  std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+	  if(!opts.stop || (ropts.deadline > 0.0 && end < until))
+	    until = end;
+	  if(wake.wait_until(lk, until, [&]() { return done; }))
+	    break;
+	  if((opts.stop && opts.stop->load())
+	     || (ropts.deadline > 0.0 && std::chrono::steady_clock::now() >= end)) {
+	    stop.store(1);
+	    break;
+	  }
+	}
+      });
+
+  // one ray to a chunk, so that each thread takes up the next ray as
+  // soon as it is done with one, however long the paths turn out
+  gt_parallel_for(0, rays, 1, [&](int b, int e) {
+      gnmworkspace ws;
+      for(int q = b; q < e; q++) {
+	if(stop.load() || (opts.stop && opts.stop->load()))
+	  continue; // not started in time
+	gnmopts qo = o;
+	qo.checkpoint = 0;
+	qo.resume = 0;
+	qo.trace = 0;
+	qo.stats = opts.stats ? &R[q].st : 0;
+	qo.lnm = opts.lnm ? &R[q].lnm : 0;
+	if(C) {
+	  if(C->deadline > 0.0) { // what is left of it
+	    R[q].ctl.deadline = C->deadline
+	      - std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	    if(R[q].ctl.deadline <= 0.0) {
+	      R[q].ctl.status = GT_RUN_BUDGET;
+	      continue;
+	    }
+	  }
+	  qo.control = &R[q].ctl;
+	}
+	R[q].numEq = GNM(A, g[q], R[q].Eq, steps, fuzz, LNMFreq, LNMMax, LambdaMin, wobble, threshold, ws, qo);
+      }
+    });
+
+  if(watch.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(lock);
+      done = 1;
+    }
+    wake.notify_all();
+    watch.join();
+  }
+
+  // merge the paths' equilibria in ray order, so that the result does
+  // not depend on which finished first
+  if(opts.stats)
+    memset(opts.stats, 0, sizeof(gtstats));
+  if(C) {
+    C->status = GT_RUN_DONE;
+    C->steps = C->supports = C->iters = 0;
+    C->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  }
+  eqset seen(A.getNumActions(), ropts.same);
+  Eq = (cvector **)malloc(sizeof(cvector *));
+  for(r = 0; r < rays; r++) {
+    for(k = 0; k < R[r].numEq; k++) {
+      if(!seen.insert(*(R[r].Eq[k]))) {
+	delete R[r].Eq[k];
+	continue;
+      }
+      Eq = (cvector **)realloc(Eq, (numEq+2)*sizeof(cvector *));
+      Eq[numEq++] = R[r].Eq[k];
+    }
+    free(R[r].Eq);
+    if(C) {
+      C->steps += R[r].ctl.steps;
+      C->supports += R[r].ctl.supports;
+      if(R[r].ctl.status > C->status)
+	C->status = R[r].ctl.status;
+    }
+    if(opts.stats)
+      addStats(*opts.stats, R[r].st);
+    if(opts.lnm) {
+      gnmlnmstats &st = *opts.lnm, &q = R[r].lnm;
+      st.calls += q.calls;
+      st.converged += q.converged;
+      st.iters += q.iters;
+      st.halvings += q.halvings;
+      st.reduction += q.reduction;
+      if(hist)
+	for(k = 0; k < hlen; k++)
+	  st.hist[k] += q.hist[k];
     }
   }
+  delete[] hist;
+  delete[] R;
   return numEq;
 }
@@ -20,9 +20,234 @@
 #ifndef __GNM_H
 #define __GNM_H
 
+#include <atomic>
+#include <unordered_map>
+#include <vector>
 #include "cmatrix.h"
 #include "gnmgame.h"
+#include "gtcontrol.h"
+#include "gnmtrace.h"
 
-int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold);
+// Totals over the LNM corrections made in a GNM call, to tune LNMFreq
+// and LNMMax by.
+struct gnmlnmstats {
+  long calls, // LNM runs
+    converged, // those that ended with the error below fuzz
+    iters, // Newton steps taken in all
+    halvings; // halvings made by the line search
+  double reduction; // the sum over the runs of log10(last error / first error)
+  long *hist; // if set, hist[k] counts the runs of k steps, for k <= LNMMax
+
+  gnmlnmstats() : calls(0), converged(0), iters(0), halvings(0), reduction(0.0), hist(0) {}
+};
+
+// An index of equilibria in which two that differ by at most tol in
+// every entry count as the same.  Each is filed under its support (the
+// entries above 2*tol) and a bucket of a fixed random projection of it,
+// so finding one looks only at those of the same support and nearby
+// projection; an entry within tol of the support cutoff is looked up
+// under both supports.
+class eqset {
+ public:
+  // for equilibria of M entries
+  eqset(int M, double tol = 1e-6);
+
+  // the index of an equilibrium within tol of e, or -1 if none is kept
+  int find(const cvector &e) const;
+  // keeps e, unless find(e) is not -1; returns 1 if it was kept
+  int insert(const cvector &e);
+
+  inline int size() const { return count; }
+  // the k-th equilibrium kept
+  inline const double *get(int k) const { return &pts[(size_t)k*M]; }
+
+ private:
+  uint64_t supportKey(const cvector &e, int *amb, int &namb) const;
+  long long bucket(const cvector &e) const;
+  int match(uint64_t key, const cvector &e) const;
+
+  int M, count;
+  double tol, width;
+  std::vector<double> proj, pts;
+  std::unordered_multimap<uint64_t, int> index;
+};
+
+class gnmcheckpoint;
+typedef void (*gnmckfn)(void *arg, const gnmcheckpoint &ck);
+
+// The state of a GNM path where it enters a support cell, from which a
+// later GNM call can carry on along the path exactly as the first one
+// would have (given the same game and parameters).  GNM, passed one
+// through gnmopts::checkpoint, takes such a snapshot as the path enters
+// every few cells; save turns the last into a compact binary blob, and
+// load takes it back for gnmopts::resume.
+class gnmcheckpoint {
+ public:
+  gnmcheckpoint() : every(1), request(0), fn(0), arg(0), N(0), M(0) {}
+
+  // a snapshot is taken every this many cells (never, if 0), and at
+  // the next cell once request is set, which clears it; fn(arg, *this),
+  // if set, is then called on the thread running GNM
+  int every;
+  std::atomic<int> request;
+  gnmckfn fn;
+  void *arg;
+
+  // whether a snapshot has been taken or loaded
+  inline int valid() const { return M > 0; }
+  // the cells the path had passed through, and the equilibria it had
+  // found, at the snapshot
+  inline long getCells() const { return cells; }
+  inline int getNumEq() const { return numEq; }
+
+  // The blob is in the machine's byte order; load returns 0, leaving
+  // this as it was, if buf is not one (or is damaged).
+  void save(std::vector<char> &buf) const;
+  int load(const char *buf, size_t len);
+
+ private:
+  friend struct gnmpath; // in gnm.cc, which takes and restores them
+
+  int N, M, Index, s_hat_old, numEq;
+  long cells;
+  double lambda;
+  std::vector<double> z, g, sigma,
+    dgat, // the profile the payoff Jacobian was last taken at
+    eq; // the equilibria found; the first numEq were at the snapshot
+  std::vector<int> B, s;
+};
+
+// Settings for GNM beyond its positional parameters (see gnm.cc).  The
+// defaults give the original algorithm.
+struct gnmopts {
+  // SOLVE_MIXED takes each step's direction and each LNM correction
+  // from a mixed-precision solve with the Jacobian, rather than from
+  // its adjoint; this is much cheaper for large games.
+  cmatrix::solvemode solve;
+
+  // if set, receives the work counted during the call (see gtstats.h)
+  gtstats *stats;
+
+  // if set, LNM keeps its Jacobian up to date with Broyden updates
+  // rather than rebuilding the payoff Jacobian at every correction
+  // (see gnmgame::LNM)
+  int broyden;
+
+  // if set, each LNM step is halved up to this many times until it
+  // brings the error down enough (see lnmsearch in gnmgame.h)
+  int backtrack;
+
+  // if set, the LNM runs are added into this
+  gnmlnmstats *lnm;
+
+  // if set, the steps through each support cell are sized as the path
+  // goes, so that its direction turns by about this many radians a
+  // step, rather than each covering 1/steps of the rest of the way.
+  // A step that takes the error past threshold is taken again, a
+  // quarter as long.  At most 1/minstep steps (steps, if minstep is 0)
+  // are taken in a cell, the last of them to its boundary, so steps
+  // average at least minstep of the way across.
+  double turn, minstep;
+
+  // How each step predicts the path.  PREDICT_EULER follows the
+  // tangent; PREDICT_HERMITE also bends with it, as it bent over the
+  // last step in the cell, which is second order rather than first.
+  enum predictmode { PREDICT_EULER = 0, PREDICT_HERMITE = 1 };
+  predictmode predictor;
+
+  // if set, GNM returns the equilibria it has found so far once *stop
+  // is nonzero, which another thread may do at any time.  With
+  // stopfirst also set, GNM sets *stop itself on finding one.
+  std::atomic<int> *stop;
+  int stopfirst;
+
+  // if positive, an equilibrium within this of one the path has
+  // already found (in every entry) is not stored again
+  double unique;
+
+  // if set, limits the call's time and steps, and can cancel it (see
+  // gtcontrol.h)
+  gtcontrol *control;
+
+  // if set, GNM takes snapshots of the path in checkpoint, and starts
+  // from the one in resume rather than from g, which it overwrites.
+  // The equilibria found before that snapshot are returned again (with
+  // a callback, only the count carries on from them).  They may be the
+  // same object.
+  gnmcheckpoint *checkpoint;
+  const gnmcheckpoint *resume;
+
+  // if set, receives a record of each step, LNM run, support change,
+  // wobble and equilibrium on the path (see gnmtrace.h)
+  gnmtrace *trace;
+
+  gnmopts() : solve(cmatrix::SOLVE_DOUBLE), stats(0), broyden(0), backtrack(0), lnm(0), turn(0.0), minstep(1e-3), predictor(PREDICT_EULER), stop(0), stopfirst(0), unique(0.0), control(0), checkpoint(0), resume(0), trace(0) {}
+};
+
+// The matrices and vectors GNM works in.  GNM sizes a workspace for the
+// game it is given, so passing the same one to a series of calls on
+// games of one shape allocates only on the first.
+class gnmworkspace {
+ public:
+  gnmworkspace() : N(0), M(0) {}
+
+  // makes room for games with N players and M actions in all
+  void resize(int N, int M);
+
+  int N, M;
+  cmatrix DG, // jacobian of the payoff function
+    I, // identity
+    J, // adjoint of the jacobian of the vector field
+    W; // Broyden updates for LNM
+  csupportproj R; // jacobian of the retraction operator
+  cvector sigma, g0, z, v, dz, dv,
+    dzlast, zlast, // dz and z at the last step, when its length is adapted
+    nothing, // all zeros
+    err, backup, G, yn1;
+  cmatrixlu Jlu;
+};
+
+int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, const gnmopts &opts = gnmopts());
+
+// The same, working in ws rather than in buffers of its own.
+int GNM(gnmgame &A, cvector &g, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts = gnmopts());
+
+// Called by GNM with each equilibrium e as it is found, and the number
+// k found so far, counting e; returning 0 stops the trace there.  e is
+// only valid during the call.
+typedef int (*gnmeqfn)(void *arg, const cvector &e, int k);
+
+// The same, passing each equilibrium to fn(arg, ...) rather than
+// storing it.  Returns the number passed.
+int GNM(gnmgame &A, cvector &g, gnmeqfn fn, void *arg, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, gnmworkspace &ws, const gnmopts &opts = gnmopts());
+
+// Settings for GNMrays.
+struct gnmraysopts {
+  // if set, the rays still running stop once one finds an equilibrium
+  int first;
+  // if positive, the rays still running stop after this many seconds
+  double deadline;
+  // an equilibrium within this of one already kept (in every entry)
+  // is dropped as the same (see eqset)
+  double same;
+
+  gnmraysopts() : first(0), deadline(0.0), same(1e-6) {}
+};
+
+// Runs GNM from each of the rays g[0..rays-1] at once, on the shared
+// thread pool (see threadpool.h), and stores in Eq the equilibria of
+// all the paths, in ray order and each only once.  Each ray is worked
+// in a workspace of its own; A is only read, and must be safe to read
+// from several threads, as nfgame is.  The rays are scaled as GNM
+// scales g.  opts.stats and opts.lnm, if set, get the totals over the
+// rays; opts.stop, if set, stops them all as it does GNM, though
+// it is only read (ropts.first and the deadline stop the rays
+// without setting it), and within 10ms.  With
+// opts.control, each ray gets its counts, the deadline is for the
+// rays together, and the control gets the totals; its status is
+// GT_RUN_CANCELLED if a ray was cancelled, or else GT_RUN_BUDGET if
+// one ran out.  opts.checkpoint, opts.resume and opts.trace are for
+// a single path, and are not used.
+int GNMrays(gnmgame &A, cvector *g, int rays, cvector **&Eq, int steps, double fuzz, int LNMFreq, int LNMMax, double LambdaMin, int wobble, double threshold, const gnmopts &opts = gnmopts(), const gnmraysopts &ropts = gnmraysopts());
 
 #endif
@@ -20,6 +20,7 @@
 #include "gnmgame.h"
 #include "cmatrix.h"
 #include "math.h"
+#include <vector>
 
 gnmgame::gnmgame(int numPlayers, int *actions): numPlayers(numPlayers) {
   int i;
@@ -49,99 +50,252 @@ gnmgame::~gnmgame() {
 
 
 
+void gnmgame::payoffVector(cvector &dest, cvector &s) {
+  cmatrix DG(numActions, numActions);
+  payoffMatrix(DG, s, 0.0);
+  DG.multiply(s, dest);
+  dest /= (double)(numPlayers - 1);
+}
+
 void gnmgame::retractJac(cmatrix &dest, int *support) {
-  int n, i, j;  
-  double totalk;
-  for(n = 0; n < numPlayers; n++) {
-    totalk = 0.0;
-    for(i = firstAction(n); i < lastAction(n); i++) {
-      totalk += support[i];
-    }
-    for(i = 0; i < numActions; i++) {
-      for(j = firstAction(n); j < lastAction(n); j++) {
-	if(i >= firstAction(n) && i < lastAction(n) && support[i] && support[j]) {
-	  if(i==j)
-	    dest[i][j] = 1.0-1.0/totalk;
-	  else
-	    dest[i][j] = -1.0/totalk;
-	} else
-	  dest[i][j] = 0.0;
+  csupportproj R;
+  retractJac(R, support);
+  R.dense(dest);
+}
+
+void gnmgame::retractJac(csupportproj &dest, int *support) {
+  dest.set(numPlayers, strategyOffset, support);
+}
+
+// Writes to dest (which may be z) the Euclidean projection of the a
+// values z onto the simplex {x >= 0, sum x = 1}, which is max(z - tau, 0)
+// for the tau that makes it sum to 1.  tau is found by Condat's method
+// ("Fast projection onto the simplex and the l1 ball", 2016) in expected
+// linear time: one pass gathers candidates for the support while
+// keeping a running estimate rho of tau, and a few short passes drop
+// the candidates that fall to rho or below.
+static void projectSimplex(double *dest, const double *z, int a) {
+  double v[a], // candidates for the support
+    w[a]; // values set aside by the first pass, checked again after it
+  int nv = 1, nw = 0, i, j, dropped;
+  double rho = z[0] - 1, t;
+
+  v[0] = z[0];
+  for(i = 1; i < a; i++) {
+    if(z[i] > rho) {
+      rho += (z[i] - rho) / (nv + 1);
+      if(rho > z[i] - 1)
+	v[nv++] = z[i];
+      else { // z[i] alone outweighs the candidates so far
+	for(j = 0; j < nv; j++)
+	  w[nw++] = v[j];
+	v[0] = z[i];
+	nv = 1;
+	rho = z[i] - 1;
       }
     }
   }
-}
+  for(j = 0; j < nw; j++) {
+    if(w[j] > rho) {
+      v[nv++] = w[j];
+      rho += (w[j] - rho) / nv;
+    }
+  }
+  do {
+    dropped = 0;
+    for(j = 0; j < nv && nv > 1; ) {
+      if(v[j] <= rho) {
+	nv--;
+	rho += (rho - v[j]) / nv;
+	v[j] = v[nv];
+	dropped = 1;
+      } else
+	j++;
+    }
+  } while(dropped);
 
-int compareDouble(const void *d1, const void *d2) {
-  if(*(double *)d1 > *(double *)d2)
-    return -1;
-  else if(*(double *)d1 < *(double *)d2)
-    return 1;
-  else
-    return 0;
+  // rho has picked up rounding along the way; take tau afresh from the
+  // support it settled on
+  t = v[0];
+  for(j = 1; j < nv; j++)
+    t += v[j];
+  t = (t - 1) / nv;
+  for(i = 0; i < a; i++) {
+    double d = z[i] - t;
+    dest[i] = d < 0.0 ? 0.0 : d;
+  }
 }
 
 void gnmgame::retract(cvector &dest, cvector &z) {
-  int n, i;
-  double v, sumz;
-  double y[numActions];
-  memcpy(y,z.values(),numActions*sizeof(double));
-  for(n = 0; n < numPlayers; n++) {  
-    qsort(y+firstAction(n),actions[n],sizeof(double),compareDouble);
-    sumz = y[firstAction(n)];
-    for(i=firstAction(n)+1; i < lastAction(n); i++) {
-      if(sumz - (i-firstAction(n)) * y[i] > 1)
-	break;
-      sumz += y[i];
-    }
-    v = (sumz - 1) / (double)(i-firstAction(n));
-    for(i = firstAction(n); i < lastAction(n); i++) {
-      dest[i] = z[i] - v;
-      if(dest[i] < 0.0)
-	dest[i] = 0.0;
-    }
+  GT_STAT_CALL(GT_KRETRACT, 6.0*numActions, 16.0*numActions);
+  for(int n = 0; n < numPlayers; n++)
+    projectSimplex(dest.values() + firstAction(n), z.values() + firstAction(n), actions[n]);
+}
+
+double gnmgame::LNM(cvector &z, const cvector &g, double det, cmatrix &J, cmatrix &DG, cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup, cmatrix *W, lnmsearch *ls) {
+  if(det == 0.0) {
+    if(ls)
+      ls->iters = ls->halvings = ls->converged = 0;
+    return fuzz;
   }
+  return LNMsteps(z, g, &J, 0, 1.0/det, DG, s, MaxLNM, fuzz, del, scratch, backup, W, ls);
 }
 
-double gnmgame::LNM(cvector &z, const cvector &g, double det, cmatrix &J, cmatrix &DG, cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup) {
-  double b, e = BIGFLOAT, ee;
-  int k, faulted = 0;
-  if(MaxLNM >= 1 && det != 0.0) {
-    b = 1.0/det;
-    for(k = 0; k < MaxLNM; k++) {
-      //      del = z - s - DG*s / (double)(numPlayers - 1) - g; 
-      DG.multiply(s,del);
-      del /= (double)(numPlayers - 1);
-      del += g;
-      del += s;
-      del -= z;
-      del.negate();
-      ee = max(del.max(),-del.min());
-
-      if(ee < fuzz) {
-	e = ee;
+double gnmgame::LNM(cvector &z, const cvector &g, cmatrixlu &F, cmatrix &DG, cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup, cmatrix *W, lnmsearch *ls) {
+  return LNMsteps(z, g, 0, &F, 1.0, DG, s, MaxLNM, fuzz, del, scratch, backup, W, ls);
+}
+
+// the error in the equilibrium equations at z, into del; DG must be
+// the payoff Jacobian at s unless W is given
+double gnmgame::LNMerror(cvector &z, const cvector &g, cmatrix &DG, cvector &s, cvector &del, cmatrix *W) {
+  //      del = z - s - DG*s / (double)(numPlayers - 1) - g; 
+  if(W) {
+    payoffVector(del, s);
+    del = -(del + g + s - z);
+  } else {
+    DG.multiply(s,del);
+    del = -(del / (double)(numPlayers - 1) + g + s - z);
+  }
+  return max(del.max(),-del.min());
+}
+
+// the Newton iterations behind both forms of LNM; each step is
+// b * J * del or b * F.solve(del), whichever of J and F is given.
+//
+// With W, that step is taken by H, the inverse Jacobian as corrected
+// by the Broyden updates so far: H = (I + u_k s_k') ... (I + u_1 s_1') H0,
+// with H0 = b J.  Row 0 of W keeps the last error, rows 1..MaxLNM the
+// u_k and rows MaxLNM+1.. the s_k, which are the steps taken.
+double gnmgame::LNMsteps(cvector &z, const cvector &g, cmatrix *J, cmatrixlu *F, double b, cmatrix &DG, cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup, cmatrix *W, lnmsearch *ls) {
+  double e = BIGFLOAT, ee, t, sy, r, b0 = b;
+  int i, k, h, nu = 0, faulted = 0, fresh = 0, B = ls ? ls->backtrack : 0;
+  if(ls)
+    ls->iters = ls->halvings = ls->converged = 0;
+  if(MaxLNM < 1)
+    return fuzz;
+  for(k = 0; k < MaxLNM; k++) {
+    if(!fresh) // the line search leaves the error at z in del
+      ee = LNMerror(z, g, DG, s, del, W);
+    fresh = 0;
+
+    if(ee < fuzz) {
+      e = ee;
+      break;
+    } else if(e < ee) { // we got worse
+      z = backup;
+      retract(s, z);
+      if(!W)
+	payoffMatrix(DG, s, fuzz);
+      if(faulted) { // if we've already failed once, quit.
+	ee = e;
 	break;
-      } else if(e < ee) { // we got worse
+      }
+      b /= MaxLNM; // if the full LNM step fails to improve things,
+      e = BIGFLOAT; // take smaller steps.
+      faulted++;
+      nu = 0; // without the updates, which led here
+      continue;
+    }
+    if(W && k > 0 && !faulted) {
+      // with y the change in the error over the last step, s_k = that
+      // step and u_k = (s_k - H y) / (s_k' H y).  backup is free to
+      // hold H y, as it is about to be replaced.
+      double *u = (*W)[nu+1], *sk = (*W)[MaxLNM+nu+1], *f = (*W)[0];
+      for(i = 0; i < numActions; i++) {
+	sk[i] = z[i] - backup[i];
+	scratch[i] = del[i] - f[i];
+      }
+      LNMapply(J, F, b, *W, MaxLNM, nu, scratch, backup);
+      sy = 0.0;
+      t = 0.0;
+      for(i = 0; i < numActions; i++) {
+	sy += sk[i] * backup[i];
+	t += sk[i] * sk[i];
+      }
+      if(fabs(sy) > 1e-12 * t) {
+	for(i = 0; i < numActions; i++)
+	  u[i] = (sk[i] - backup[i]) / sy;
+	nu++;
+      }
+    }
+    e = ee;
+    if(W) {
+      for(i = 0; i < numActions; i++)
+	(*W)[0][i] = del[i];
+      LNMapply(J, F, b, *W, MaxLNM, nu, del, scratch);
+    } else if(J)
+      J->multiply(del, scratch);
+    else
+      F->solve(del, scratch);
+    //      z = z - (J * del) * b;
+    // With a line search, the step is halved until the error falls by
+    // at least armijo times the fraction of it taken, and if B halvings
+    // do not manage that, z stays where it is and LNM stops.
+    backup = z;
+    for(h = 0, t = 1.0; ; h++, t *= 0.5) {
+      if(h)
 	z = backup;
-	retract(s, z);
+      z -= scratch*((W ? 1.0 : b) * t);
+      retract(s, z);
+      if(!W)
 	payoffMatrix(DG, s, fuzz);
-      	if(faulted) // if we've already failed once, quit.
-	  return e;
-	b /= MaxLNM; // if the full LNM step fails to improve things,
-	e = BIGFLOAT; // take smaller steps.
-	faulted++;
-	continue;
+      if(!B)
+	break;
+      r = LNMerror(z, g, DG, s, del, W);
+      if(r <= (1.0 - ls->armijo * t) * ee) {
+	fresh = 1;
+	break;
       }
-      e = ee;
-      J.multiply(del, scratch);
-      scratch *= b;
-      backup = z;
-      z -= scratch;
-      //      z = z - (J * del) * b;
+      if(h == B)
+	break;
+      ls->halvings++;
+    }
+    if(ls) {
+      if(ls->err)
+	ls->err[ls->iters] = ee;
+      if(ls->step)
+	ls->step[ls->iters] = B && !fresh ? 0.0 : t * b / b0;
+      ls->iters++;
+    }
+    if(B && !fresh) { // no step helped
+      z = backup;
       retract(s, z);
-      payoffMatrix(DG, s, fuzz);
+      if(!W)
+	payoffMatrix(DG, s, fuzz);
+      break;
     }
-    return ee;
-  } else return fuzz;
+    if(fresh)
+      ee = r;
+  }
+  if(W) // leave DG at s, as the callers expect
+    payoffMatrix(DG, s, fuzz);
+  if(ls) {
+    // having run out of steps, LNM reports the error before the last
+    // one, as it always has; the record has the error after it
+    r = k == MaxLNM && !fresh ? LNMerror(z, g, DG, s, del, 0) : ee;
+    if(ls->err)
+      ls->err[ls->iters] = r;
+    ls->converged = r < fuzz;
+  }
+  return ee;
+}
+
+// y = H x, for H as in LNMsteps with its first nu updates
+void gnmgame::LNMapply(cmatrix *J, cmatrixlu *F, double b, cmatrix &W, int MaxLNM, int nu, cvector &x, cvector &y) {
+  int i, k;
+  double t;
+  if(J)
+    J->multiply(x, y);
+  else
+    F->solve(x, y);
+  y *= b;
+  for(k = 0; k < nu; k++) {
+    const double *u = W[k+1], *sk = W[MaxLNM+k+1];
+    t = 0.0;
+    for(i = 0; i < numActions; i++)
+      t += sk[i] * y[i];
+    ck_axpy(numActions, t, u, y.values());
+  }
 }
 
 void gnmgame::normalizeStrategy(cvector &s) {
@@ -157,84 +311,214 @@ void gnmgame::normalizeStrategy(cvector &s) {
   }
 }
 
-int indexOf(int *list, int target, int length) {
-  for(int i = 0; i < length; i++) {
-    if(list[i] == target)
-      return i;
+// LemkeHowson keeps, for each label, where it sits: at[label] is i if
+// the label is col[i], and -i-1 if it is row[i].  The labels run from
+// -(numActions+numPlayers) to numActions+numPlayers+2, so at points into
+// the middle of its array.
+static inline int colOf(const int *at, int label) {
+  return at[label] >= 0 ? at[label] : -1;
+}
+
+static inline int rowOf(const int *at, int label) {
+  return at[label] < 0 ? -at[label]-1 : -1;
+}
+
+// records the labels Pivot swapped at (pr,pc)
+static inline void relabel(int *at, const int *row, const int *col, int pr, int pc) {
+  at[row[pr]] = -pr-1;
+  at[col[pc]] = pc;
+}
+
+int gnmgame::lhSparseMin = 64;
+int gnmgame::lhRefactor = 50;
+double gnmgame::lhSparseDensity = 0.1;
+double gnmgame::lhDenseFill = 0.2;
+
+static inline double lhAt(cmatrix &T, const lhsparse *S, lhrevised *V, int i, int j) {
+  return V ? V->get(i, j) : S ? S->get(i, j) : T[i][j];
+}
+
+void gnmgame::LemkeHowson(cvector &dest, cmatrix &T, int *Im, lhmode mode, lhsparse *sp, lhrevised *rv, int *basis) {
+  lhrevised localrv;
+  if(!rv)
+    rv = &localrv;
+  if(basis && basis[0] && LHRun(dest, T, Im, 0, rv, 0, basis, 1))
+    return;
+  if(mode == LH_REVISED) {
+    if(LHRun(dest, T, Im, 0, rv, 0, basis, 0))
+      return;
+    mode = LH_DENSE; // the revised form leaves T alone, so start again
   }
-  return -1;
+  lhsparse local, *S = 0;
+  if(mode == LH_SPARSE || (mode == LH_AUTO && T.getm() >= lhSparseMin)) {
+    S = sp ? sp : &local;
+    S->load(T);
+    if(mode == LH_AUTO && S->density() > lhSparseDensity)
+      S = 0;
+  }
+  LHRun(dest, T, Im, S, 0, mode == LH_AUTO, basis, 0);
 }
 
-void gnmgame::LemkeHowson(cvector &dest, cmatrix &T, int *Im) {
+int gnmgame::LHRun(cvector &dest, cmatrix &T, int *Im, lhsparse *S, lhrevised *V, int fill, int *basis, int warm) {
   double D = 1;
   int cg = numActions + numPlayers ;
   int K = cg+1;
-  int n, pc, pr, p;
-  double m;
+  int n, pc, pr, p, left = -1;
+  double m, t;
   int col[numActions+numPlayers+2], row[numActions+numPlayers];
-  for(n = 0; n < numActions+numPlayers+2; n++)
-    col[n] = n+1;
-  for(n = 0; n < numActions+numPlayers; n++)
-    row[n] = -n-1;
-  for(n = 0; n < numPlayers; n++) {
-    pc = indexOf(col, Im[n]+1, numActions+numPlayers+2);
-    pr = indexOf(row,-numActions-n-1, numActions+numPlayers);
-    p = Pivot(T, pr, pc, row, col, D);
-    pc = indexOf(col, numActions+n+1, numActions+numPlayers+2);
-    pr = indexOf(row, -Im[n]-1, numActions+numPlayers);
-    p = Pivot(T, pr, pc, row, col, D);
-  }
-  pc = indexOf(col, cg+1, numActions+numPlayers+2);
+  int atbuf[2*(numActions+numPlayers)+3], *at = atbuf+numActions+numPlayers;
+  if(warm) {
+    // start from the basis in basis[], which must be complementary,
+    // with the artificial label's column set to -1 in each row that
+    // has a sign constraint.  If the basis is feasible that column
+    // never enters; otherwise it enters where the basis is most
+    // infeasible and the pivoting below works its way back out.
+    for(n = -cg; n <= K+1; n++)
+      at[n] = K+2;
+    for(n = 0; n < cg; n++) {
+      row[n] = basis[n];
+      if(row[n] == 0 || row[n] < -cg || row[n] > cg || at[row[n]] != K+2 || at[-row[n]] != K+2)
+	return 0;
+      at[row[n]] = -n-1;
+    }
+    for(n = 0, p = 1; p <= cg; p++, n++) {
+      col[n] = at[p] == K+2 ? p : -p;
+      at[col[n]] = n;
+    }
+    col[cg] = cg+1;
+    at[cg+1] = cg;
+    col[K] = K+1;
+    at[K+1] = K;
+    if(!V->load(T, row, col))
+      return 0;
+    std::vector<double> d(cg, 0.0);
+    for(n = 0; n < cg; n++) {
+      p = row[n];
+      if(p > numActions && p <= numActions+numPlayers)
+	continue;
+      if(p < 0)
+	d[-p-1] -= 1.0;
+      else
+	for(pr = 0; pr < cg; pr++)
+	  d[pr] -= T[pr][p-1];
+    }
+    V->cover(cg+1, &d[0]);
+    left = 4*cg; // beyond this many pivots, a cold start is likely quicker
+  } else {
+    for(n = 0; n < numActions+numPlayers+2; n++) {
+      col[n] = n+1;
+      at[n+1] = n;
+    }
+    for(n = 0; n < numActions+numPlayers; n++) {
+      row[n] = -n-1;
+      at[-n-1] = -n-1;
+    }
+    if(V)
+      V->load(T, row, col);
+    for(n = 0; n < numPlayers; n++) {
+      pc = colOf(at, Im[n]+1);
+      pr = rowOf(at, -numActions-n-1);
+      if(!(p = LHPivot(T, S, V, fill, pr, pc, row, col, D)))
+	return 0;
+      relabel(at, row, col, pr, pc);
+      pc = colOf(at, numActions+n+1);
+      pr = rowOf(at, -Im[n]-1);
+      if(!(p = LHPivot(T, S, V, fill, pr, pc, row, col, D)))
+	return 0;
+      relabel(at, row, col, pr, pc);
+    }
+  }
+  pc = colOf(at, cg+1);
   m = -BIGFLOAT;
   pr = -1;
   for(n = 0; n < numPlayers + numActions; n++) {
-    if(T[n][pc] < 0) {
-      if(T[n][K] / T[n][pc] > m) {
-        m = T[n][K] / T[n][pc];
+    if((t = lhAt(T, S, V, n, pc)) < 0) {
+      if(lhAt(T, S, V, n, K) / t > m) {
+        m = lhAt(T, S, V, n, K) / t;
 	pr = n;
       }
     }
   }
 
   if(m > 0) {
-    p = Pivot(T, pr, pc, row, col, D);
+    if(!(p = LHPivot(T, S, V, fill, pr, pc, row, col, D)))
+      return 0;
+    relabel(at, row, col, pr, pc);
     do {
-      pc = indexOf(col, -p, numActions+numPlayers+2);
+      pc = colOf(at, -p);
       m = BIGFLOAT;
       pr = -1;
       for(n = 0; n < numPlayers + numActions; n++) {
-	if(T[n][pc] > 0 && (row[n] <= numActions || row[n] > numActions+numPlayers)) {
-	  if(T[n][K] / T[n][pc] < m) {
-	    m = T[n][K] / T[n][pc];
+	if((t = lhAt(T, S, V, n, pc)) > 0 && (row[n] <= numActions || row[n] > numActions+numPlayers)) {
+	  if(lhAt(T, S, V, n, K) / t < m) {
+	    m = lhAt(T, S, V, n, K) / t;
 	    pr = n;
 	  }
 	}
       }
-      p = Pivot(T, pr, pc, row, col, D);
+      if(pr < 0 || left-- == 0) // only a warm start can run off
+	return 0;
+      if(!(p = LHPivot(T, S, V, fill, pr, pc, row, col, D)))
+	return 0;
+      relabel(at, row, col, pr, pc);
     } while(p != cg+1);
   }
   for(n = 0; n < numActions; n++) {
-    pr = indexOf(row,n+1,numActions+numPlayers);
+    pr = rowOf(at, n+1);
     if(pr == -1)
       dest[n] = 0.0;
     else
-      dest[n] = T[pr][K] / D;
+      dest[n] = lhAt(T, S, V, pr, K) / D;
+  }
+  if(warm) {
+    // a long way from the old basis the etas can lose accuracy, so
+    // make sure each player's strategy is still a distribution
+    for(n = 0; n < numPlayers; n++) {
+      t = 0.0;
+      for(p = firstAction(n); p < lastAction(n); p++) {
+	if(dest[p] < -1e-9)
+	  return 0;
+	t += dest[p];
+      }
+      if(fabs(t - 1.0) > 1e-6)
+	return 0;
+    }
+  }
+  if(basis)
+    for(n = 0; n < numActions+numPlayers; n++)
+      basis[n] = row[n];
+  return 1;
+}
+
+int gnmgame::LHPivot(cmatrix &T, lhsparse *&S, lhrevised *V, int fill, int pr, int pc, int *row, int *col, double &D) {
+  if(V)
+    return V->pivot(pr, pc, row, col, D);
+  if(!S)
+    return Pivot(T, pr, pc, row, col, D);
+  int p = S->pivot(pr, pc, row, col, D);
+  if(fill && S->density() > lhDenseFill) {
+    S->store(T);
+    S = 0;
   }
+  return p;
 }
 
 int gnmgame::Pivot(cmatrix &T, int pr, int pc, int *row, int *col, double &D) {
-  double pivot = T[pr][pc];
+  int w = numActions+numPlayers+2;
+  double *Tp = T.values() + (size_t)pr*w, *Ti;
+  double pivot = Tp[pc], t;
   int i0,j0,p,sgn = pivot < 0 ? -1 : 1;
+  double r = 1.0/(D*sgn);
   
+  GT_STAT_CALL(GT_KPIVOT, 4.0*(numActions+numPlayers-1)*(numActions+numPlayers+1) + numActions+numPlayers+2, 16.0*(numActions+numPlayers)*(numActions+numPlayers+2));
+  // every row but pr becomes (pivot*row - row[pc]*T[pr]) / (D*sgn),
+  // except in column pc, which keeps its old value
   for(i0 = 0; i0 < numActions+numPlayers; i0++) {
     if(i0 != pr) {
-      for(j0 = 0; j0 < numActions+numPlayers+2; j0++) {
-	if(j0 != pc) {
-	  T[i0][j0] *= pivot;
-	  T[i0][j0] -= T[i0][pc] * T[pr][j0];
-	  T[i0][j0] /= D * sgn;
-	}
-      }
+      Ti = T.values() + (size_t)i0*w;
+      t = Ti[pc];
+      ck_pivot(w, pivot, t, r, Tp, Ti);
+      Ti[pc] = t;
     }
   }
   if(sgn == 1) {
@@ -252,10 +536,350 @@ int gnmgame::Pivot(cmatrix &T, int pr, int pc, int *row, int *col, double &D) {
   row[pr] = col[pc];
   col[pc] = p;
   if(D > 1e6) {
+    GT_STAT_WORK(GT_KPIVOT, (double)T.getm()*T.getn(), 16.0*T.getm()*T.getn());
     T /= D;
     D = 1;
   }
   return p;
 }
 
+lhsparse::lhsparse() : m(0), n(0), rows(0), nnz(0), len(0), idx(0), val(0), ibuf(0), vbuf(0) {}
+
+lhsparse::~lhsparse() {
+  delete[] len;
+  delete[] idx;
+  delete[] val;
+  delete[] ibuf;
+  delete[] vbuf;
+}
+
+void lhsparse::load(const cmatrix &T) {
+  int i, j, k;
+  const double *t = T.values();
+  if(T.getm() > rows || T.getn() != n) {
+    delete[] len;
+    delete[] idx;
+    delete[] val;
+    delete[] ibuf;
+    delete[] vbuf;
+    rows = T.getm();
+    len = new int[rows];
+    idx = new int*[rows+1];
+    val = new double*[rows+1];
+    ibuf = new int[(size_t)(rows+1)*T.getn()];
+    vbuf = new double[(size_t)(rows+1)*T.getn()];
+  }
+  m = T.getm();
+  n = T.getn();
+  // rows trade storage with the spare row as they are pivoted, so set
+  // them all up afresh
+  for(i = 0; i <= m; i++) {
+    idx[i] = ibuf + (size_t)i*n;
+    val[i] = vbuf + (size_t)i*n;
+  }
+  nnz = 0;
+  for(i = 0; i < m; i++, t += n) {
+    for(j = k = 0; j < n; j++)
+      if(t[j] != 0.0) {
+	idx[i][k] = j;
+	val[i][k++] = t[j];
+      }
+    len[i] = k;
+    nnz += k;
+  }
+}
+
+void lhsparse::store(cmatrix &T) const {
+  T = 0.0;
+  for(int i = 0; i < m; i++)
+    for(int k = 0; k < len[i]; k++)
+      T[i][idx[i][k]] = val[i][k];
+}
+
+// where column j is in row i's entries, or -1
+int lhsparse::find(int i, int j) const {
+  const int *c = idx[i];
+  int lo = 0, hi = len[i], mid;
+  while(lo < hi) {
+    mid = (lo + hi) / 2;
+    if(c[mid] < j)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < len[i] && c[lo] == j ? lo : -1;
+}
+
+double lhsparse::get(int i, int j) const {
+  int k = find(i, j);
+  return k < 0 ? 0.0 : val[i][k];
+}
+
+// The update is that of ck_pivot_ref, entry for entry, so this gives
+// the same tableau as gnmgame::Pivot with the scalar kernels (not with
+// the SIMD ones, which fuse the multiply and subtract); a row with a
+// zero in column pc keeps its pattern, and any other row takes on the
+// pattern of row pr.  Entries that cancel to zero are dropped.
+int lhsparse::pivot(int pr, int pc, int *row, int *col, double &D) {
+  double pivot = get(pr, pc), t, v;
+  int i, a, b, k, c, p, sgn = pivot < 0 ? -1 : 1;
+  double r = 1.0/(D*sgn), work = 0.0;
+  const int *pi = idx[pr];
+  const double *pv = val[pr];
+  int pl = len[pr];
+
+  for(i = 0; i < m; i++) {
+    if(i == pr)
+      continue;
+    int *ii = idx[i], il = len[i];
+    double *iv = val[i];
+    work += il;
+    if((t = get(i, pc)) == 0.0) {
+      for(a = 0; a < il; a++)
+	iv[a] = (pivot * iv[a]) * r;
+      continue;
+    }
+    int *oi = idx[m];
+    double *ov = val[m];
+    a = b = k = 0;
+    while(a < il || b < pl) {
+      if(b == pl || (a < il && ii[a] < pi[b])) {
+	c = ii[a];
+	v = (pivot * iv[a++]) * r;
+      } else if(a == il || pi[b] < ii[a]) {
+	c = pi[b];
+	v = -(t * pv[b++]) * r;
+      } else {
+	c = ii[a];
+	v = (pivot * iv[a++] - t * pv[b++]) * r;
+      }
+      if(c == pc)
+	v = t;
+      if(v != 0.0) {
+	oi[k] = c;
+	ov[k++] = v;
+      }
+    }
+    work += pl;
+    nnz += k - il;
+    len[i] = k;
+    idx[m] = ii;
+    val[m] = iv;
+    idx[i] = oi;
+    val[i] = ov;
+  }
+  GT_STAT_CALL(GT_KPIVOT, 4.0*work, 24.0*work);
+
+  if(sgn == 1) {
+    for(i = 0; i < m; i++)
+      if((a = find(i, pc)) >= 0)
+	val[i][a] = -val[i][a];
+  } else {
+    for(a = 0; a < pl; a++)
+      val[pr][a] = -val[pr][a];
+  }
+  val[pr][find(pr, pc)] = sgn * D;
+  D = pivot < 0 ? -pivot : pivot;
+  p = row[pr];
+  row[pr] = col[pc];
+  col[pc] = p;
+  if(D > 1e6) {
+    for(i = 0; i < m; i++)
+      for(a = 0; a < len[i]; a++)
+	val[i][a] /= D;
+    D = 1;
+  }
+  return p;
+}
+
+lhrevised::lhrevised() : A(0), row(0), col(0), m(0), n(0), size(0), s(0), neta(0), ecap(0), ycol(-1), covlab(0),
+  blab(0), slot(0), rp(0), sc(0), sl(0), epos(0), eta(0), beta(0), y(0), cov(0), c(0), z(0), w(0), K(0,0), P(0,0) {}
+
+lhrevised::~lhrevised() {
+  delete[] blab;
+  delete[] slot;
+  delete[] rp;
+  delete[] sc;
+  delete[] sl;
+  delete[] epos;
+  delete[] eta;
+  delete[] beta;
+  delete[] y;
+  delete[] c;
+  delete[] z;
+  delete[] w;
+  delete[] cov;
+}
+
+int lhrevised::load(const cmatrix &T, const int *row, const int *col) {
+  A = &T;
+  this->row = row;
+  this->col = col;
+  m = T.getm();
+  n = T.getn();
+  covlab = 0;
+  if(m > size) {
+    delete[] blab;
+    delete[] slot;
+    delete[] rp;
+    delete[] sc;
+    delete[] sl;
+    delete[] beta;
+    delete[] y;
+    delete[] c;
+    delete[] z;
+    delete[] w;
+    delete[] cov;
+    size = m;
+    blab = new int[size];
+    slot = new int[size];
+    rp = new int[size];
+    sc = new int[size];
+    sl = new int[size];
+    beta = new double[size];
+    y = new double[size];
+    c = new double[size];
+    z = new double[size];
+    w = new double[size];
+    cov = new double[size];
+    ecap = 0;
+  }
+  if(ecap != gnmgame::lhRefactor) {
+    delete[] epos;
+    delete[] eta;
+    ecap = gnmgame::lhRefactor;
+    epos = new int[ecap];
+    eta = new double[(size_t)ecap*size];
+  }
+  return refactor();
+}
+
+void lhrevised::cover(int label, const double *d) {
+  covlab = label;
+  for(int i = 0; i < m; i++)
+    cov[i] = d[i];
+  ycol = -1;
+}
+
+double lhrevised::get(int i, int j) {
+  if(j == n-1)
+    return beta[i];
+  if(j != ycol) {
+    column(j, y);
+    ycol = j;
+  }
+  return y[i];
+}
+
+void lhrevised::column(int j, double *y) {
+  solve(col[j], y);
+}
+
+// y = inverse(basis) * (the original column of label); a label -k is
+// slack k, whose column is the unit vector e_k, and a label k > 0 is
+// column k-1 of A
+void lhrevised::solve(int label, double *y) {
+  const double *a = A->values();
+  int i, k;
+  if(label == covlab) {
+    for(i = 0; i < m; i++)
+      c[i] = cov[i];
+  } else if(label < 0) {
+    for(i = 0; i < m; i++)
+      c[i] = 0.0;
+    c[-label-1] = 1.0;
+  } else {
+    for(i = 0; i < m; i++)
+      c[i] = a[(size_t)i*n + label-1];
+  }
+  // the factored block gives the structural values, and the slack
+  // values follow from the rows they cover
+  for(k = 0; k < s; k++)
+    z[k] = c[rp[k]];
+  if(s) {
+    Klu.solve(z, z);
+    ck_gemv(m-s, s, P.values(), s, z, w);
+  }
+  for(i = 0; i < m; i++) {
+    if(blab[i] > 0)
+      y[i] = z[slot[i]];
+    else
+      y[i] = s ? c[-blab[i]-1] - w[slot[i]] : c[-blab[i]-1];
+  }
+  for(k = 0; k < neta; k++) {
+    const double *e = eta + (size_t)k*m;
+    int p = epos[k];
+    double yp = y[p] / e[p];
+    ck_axpy(m, -yp, e, y);
+    y[p] = yp;
+  }
+  GT_STAT_WORK(GT_KPIVOT, 2.0*s*s + 2.0*(m-s)*s + 2.0*neta*m, 8.0*s*s + 8.0*(m-s)*s + 8.0*neta*m);
+}
+
+// factors the current basis, and recomputes beta against it
+int lhrevised::refactor() {
+  int i, j, k, ns = 0;
+  const double *a = A->values();
+  neta = 0;
+  ycol = -1;
+  s = 0;
+  for(i = 0; i < m; i++)
+    c[i] = 0.0; // marks the rows covered by slacks
+  for(i = 0; i < m; i++) {
+    blab[i] = row[i];
+    if(row[i] > 0) {
+      sc[s] = row[i]-1;
+      slot[i] = s++;
+    } else {
+      c[-row[i]-1] = 1.0;
+      sl[ns] = i;
+      slot[i] = ns++;
+    }
+  }
+  for(i = k = 0; i < m; i++)
+    if(c[i] == 0.0)
+      rp[k++] = i;
+  if(s) {
+    K.reshape(s, s);
+    for(i = 0; i < s; i++)
+      for(j = 0; j < s; j++)
+	K[i][j] = a[(size_t)rp[i]*n + sc[j]];
+    P.reshape(ns, s);
+    for(i = 0; i < ns; i++) {
+      const double *ar = a + (size_t)(-blab[sl[i]]-1)*n;
+      for(j = 0; j < s; j++)
+	P[i][j] = ar[sc[j]];
+    }
+    if(!Klu.factor(K))
+      return 0;
+  }
+  solve(n, beta);
+  return 1;
+}
+
+int lhrevised::pivot(int pr, int pc, int *row, int *col, double &D) {
+  int i, p;
+  if(pc != ycol) {
+    column(pc, y);
+    ycol = pc;
+  }
+  if(y[pr] == 0.0)
+    return 0;
+  GT_STAT_CALL(GT_KPIVOT, 3.0*m, 24.0*m);
+  double *e = eta + (size_t)neta*m, t = beta[pr] / y[pr];
+  for(i = 0; i < m; i++) {
+    e[i] = y[i];
+    beta[i] -= y[i] * t;
+  }
+  beta[pr] = t;
+  epos[neta++] = pr;
+  ycol = -1;
+  p = row[pr];
+  row[pr] = col[pc];
+  col[pc] = p;
+  D = 1;
+  if(neta == ecap && !refactor())
+    return 0;
+  return p;
+}
    
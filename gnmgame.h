@@ -23,6 +23,113 @@
 #include "cmatrix.h"
 #define BIGFLOAT 3.0e+28F
 
+// A Lemke-Howson tableau kept by rows, each holding only its nonzero
+// entries in column order.  LemkeHowson pivots in this form when the
+// tableau is mostly zeros (see gnmgame::lhmode); keeping one of these
+// across calls saves reallocating its rows.
+class lhsparse {
+ public:
+  lhsparse();
+  ~lhsparse();
+
+  // takes the nonzero entries of T
+  void load(const cmatrix &T);
+  // writes the tableau out to T, which must be the size loaded
+  void store(cmatrix &T) const;
+
+  double get(int i, int j) const;
+  // the fraction of the entries that are nonzero
+  inline double density() const { return (double)nnz / ((double)m*n); }
+
+  // the same pivot as gnmgame::Pivot, done on the nonzero entries
+  int pivot(int pr, int pc, int *row, int *col, double &D);
+
+ private:
+  int find(int i, int j) const;
+
+  int m, n, rows; // rows: how many rows there is room for
+  long nnz;
+  int *len, **idx; // row i has len[i] entries, in columns idx[i]
+  double **val; // with values val[i]
+  int *ibuf; // room for rows+1 rows (one for merging into) of n entries
+  double *vbuf;
+};
+
+// The basis of a Lemke-Howson tableau, kept as a factorization in
+// place of the tableau (the revised simplex method).  Column j of the
+// tableau is the inverse of the basis times the original column of
+// the label now at col[j], so each pivot needs just one solve, for the
+// entering column.  Basic slack labels make the basis an identity in
+// their columns, so only the square block of original columns and
+// uncovered rows is factored; each pivot since then is kept as an eta
+// (product-form) update, and after gnmgame::lhRefactor of them the
+// basis is factored afresh.
+class lhrevised {
+ public:
+  lhrevised();
+  ~lhrevised();
+
+  // starts from tableau T, to be pivoted with label arrays row and
+  // col, all of which must outlast the pivoting.  T is not changed.
+  // row may name any basis, not just the initial one; returns 0 if
+  // that basis is singular.
+  int load(const cmatrix &T, const int *row, const int *col);
+
+  // makes d the original column of the given label, in place of the
+  // one in T, until the next load
+  void cover(int label, const double *d);
+
+  // entry (i,j) of the current tableau, with D = 1
+  double get(int i, int j);
+
+  // the same pivot as gnmgame::Pivot.  Returns 0 if the basis turned
+  // out singular, after which this cannot go on.
+  int pivot(int pr, int pc, int *row, int *col, double &D);
+
+ private:
+  void column(int j, double *y);
+  void solve(int label, double *y);
+  int refactor();
+
+  const cmatrix *A;
+  const int *row, *col;
+  int m, n, size, s, neta, ecap, ycol, covlab;
+  int *blab, // the labels of the factored basis
+    *slot, // where a structural label's value is in the factored block
+    *rp, // the rows of the block
+    *sc, // and the columns of A it takes
+    *sl; // the basis positions of the slack labels
+  int *epos; // eta k replaces basis column epos[k]
+  double *eta, // with eta[k*m..k*m+m-1]
+    *beta, // the constant column of the tableau
+    *y, // column ycol of the tableau, if ycol >= 0
+    *cov, // the column given to cover
+    *c, *z, *w; // scratch
+  cmatrix K, // the factored block of the basis
+    P; // the rows of A of its slacks, in the columns of K
+  cmatrixlu Klu;
+};
+
+// Asks LNM for a line search, and receives a record of its steps.
+struct lnmsearch {
+  // each step is halved, up to backtrack times, until it cuts the error
+  // by at least armijo times the fraction of the step taken; if none
+  // does, LNM stops there.  With backtrack 0, a step that makes things
+  // worse is undone and the rest are cut by MaxLNM, as without this.
+  int backtrack;
+  double armijo;
+
+  // filled in by LNM: the steps taken, the halvings made, and whether
+  // the error ended below fuzz.  If err and step are set, they need
+  // room for MaxLNM+1 entries; err[k] receives the error before step k
+  // (err[iters], the error at the end) and step[k] the fraction of the
+  // full step taken, 0 if the search gave up on it.
+  int iters, halvings, converged;
+  double *err, *step;
+
+  lnmsearch() : backtrack(0), armijo(1e-4), iters(0), halvings(0), converged(0), err(0), step(0) {}
+};
+
 class gnmgame {
  public:
   
@@ -57,9 +164,19 @@ class gnmgame {
   // the owner of action i if he deviates from s by choosing i instead.
   virtual void payoffMatrix(cmatrix &dest, cvector &s, double fuzz) = 0;
 
+  // This stores in dest the payoff to the owner of each action i for
+  // playing i against s, which is payoffMatrix(s) * s / (numPlayers-1).
+  // The default builds the whole Jacobian for it; games that can find
+  // the payoffs directly should override it.
+  virtual void payoffVector(cvector &dest, cvector &s);
+
   // this stores the Jacobian of the retraction function in dest.  
   void retractJac(cmatrix &dest, int *support);
 
+  // The same, kept as the per-player supports; GNM multiplies by this
+  // form, which avoids an M x M product at every step.
+  void retractJac(csupportproj &dest, int *support);
+
   // This retracts z onto the nearest normalized strategy profile, according
   // to the Euclidean metric
   void retract(cvector &dest, cvector &z);
@@ -69,12 +186,51 @@ class gnmgame {
   // under the homeomorphism.  In order to prevent costly memory allocation,
   // a number of scratch vectors are passed in.
 
-  double LNM(cvector &z, const cvector &g, double det, cmatrix &J, cmatrix &DG,  cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup);
+  //
+  // If W is given (with room for 2*MaxLNM+1 rows of numActions), the
+  // Jacobian's inverse is corrected by a Broyden update after each
+  // step, and the error is measured with payoffVector, so DG is only
+  // rebuilt once, at the end.  Should a step make things worse, the
+  // updates are dropped and the remaining steps are taken as without W.
+  //
+  // ls, if given, sets up a line search on each step and gets a record
+  // of the steps (see lnmsearch).
+  double LNM(cvector &z, const cvector &g, double det, cmatrix &J, cmatrix &DG,  cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup, cmatrix *W = 0, lnmsearch *ls = 0);
+
+  // The same, with each Newton step solved against F, a factorization
+  // of the Jacobian, instead of multiplied by its adjoint J / det.
+  double LNM(cvector &z, const cvector &g, cmatrixlu &F, cmatrix &DG,  cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup, cmatrix *W = 0, lnmsearch *ls = 0);
 
   // This normalizes a strategy profile by scaling appropriately.
   void normalizeStrategy(cvector &s);
 
-  void LemkeHowson(cvector &dest, cmatrix &T, int *Im);
+  // How LemkeHowson pivots.  LH_DENSE updates the whole tableau at
+  // every pivot.  LH_SPARSE works on its nonzero entries only, which
+  // pays off when the payoff Jacobian is mostly zeros, as it is for
+  // polymatrix and graphical games.  LH_AUTO goes sparse on tableaux
+  // of at least lhSparseMin rows with at most lhSparseDensity of their
+  // entries nonzero, and turns back to dense pivoting if fill-in takes
+  // the density above lhDenseFill.  The sparse pivots round as the
+  // scalar ck_pivot_ref does, so where ck_pivot uses fused
+  // multiply-adds they may differ from LH_DENSE in the last bits.
+  // LH_REVISED keeps a factored basis instead of the tableau (see
+  // lhrevised) and falls back on LH_DENSE if the basis goes singular.
+  enum lhmode { LH_AUTO = 0, LH_DENSE = 1, LH_SPARSE = 2, LH_REVISED = 3 };
+  static int lhSparseMin, lhRefactor;
+  static double lhSparseDensity, lhDenseFill;
+
+  // Solves the polymatrix game whose tableau is T, starting from the
+  // best responses Im; T is overwritten.  sp and rv, if given, are
+  // used for the sparse and revised forms rather than temporary ones.
+  //
+  // basis, if given, has a label for each row of T and receives the
+  // labels of the final basis.  If it already holds one (basis[0] is
+  // not 0) from a call on a tableau of the same shape, pivoting starts
+  // from that basis, in the revised form, rather than from Im.  If it
+  // is infeasible for T, an artificial column that is -1 in its sign
+  // constrained rows covers it.  Should that run off or take too long,
+  // the call starts again from Im.
+  void LemkeHowson(cvector &dest, cmatrix &T, int *Im, lhmode mode = LH_DENSE, lhsparse *sp = 0, lhrevised *rv = 0, int *basis = 0);
 
 
   inline int getNumPlayers() { return numPlayers; }
@@ -84,7 +240,21 @@ class gnmgame {
 
  protected:
   
+  double LNMsteps(cvector &z, const cvector &g, cmatrix *J, cmatrixlu *F, double b, cmatrix &DG, cvector &s, int MaxLNM, double fuzz, cvector &del, cvector &scratch, cvector &backup, cmatrix *W, lnmsearch *ls);
+  double LNMerror(cvector &z, const cvector &g, cmatrix &DG, cvector &s, cvector &del, cmatrix *W);
+
+  void LNMapply(cmatrix *J, cmatrixlu *F, double b, cmatrix &W, int MaxLNM, int nu, cvector &x, cvector &y);
+
   int Pivot(cmatrix &T, int pr, int pc, int *row, int *col, double &D);
+  // LemkeHowson on whichever of V, S and T is given first, or if warm
+  // is set, on V from the basis in basis[]; returns 0 if V failed or
+  // the warm start gave up
+  int LHRun(cvector &dest, cmatrix &T, int *Im, lhsparse *S, lhrevised *V, int fill, int *basis, int warm);
+
+  // Pivot on V or S if one is set and on T otherwise; if fill is set,
+  // S is written back to T and dropped once it gets too dense.
+  // Returns 0 if V failed.
+  int LHPivot(cmatrix &T, lhsparse *&S, lhrevised *V, int fill, int pr, int pc, int *row, int *col, double &D);
 
   int *strategyOffset;
   int numPlayers, numStrategies, numActions;
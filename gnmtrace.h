@@ -0,0 +1,133 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __GNMTRACE_H
+#define __GNMTRACE_H
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+// A record of what a GNM path did, one per event, for finding where a
+// run went astray and for tuning steps, LNMFreq and threshold.  GNM
+// writes them to the gnmtrace passed through gnmopts::trace; without
+// one it does nothing more than test the pointer.
+enum gnmtracekind {
+  GNM_TR_STEP = 0, // a step along the path
+  GNM_TR_RETRY = 1, // a step left the path and is to be taken again shorter
+  GNM_TR_LNM = 2, // LNM brought the point back to the path
+  GNM_TR_ENTER = 3, // an action entered the support, at a cell boundary
+  GNM_TR_LEAVE = 4, // an action left it
+  GNM_TR_EQ = 5, // lambda reached 0, at an equilibrium
+  GNM_TR_WOBBLE = 6 // the ray was wobbled back onto the path
+};
+
+// Each is 64 bytes, in the machine's byte order.  Fields a kind has no
+// use for are 0.
+struct gnmtracerec {
+  int64_t cell; // support cells the path has entered
+  int32_t kind, // a gnmtracekind
+    step, // steps taken in the cell, counting this one
+    action, // ENTER, LEAVE: the action; STEP: 1 if it was bent
+    // (see gnmopts::predictor); LNM: its steps, or -1 if not
+    // counted; EQ: 1 if it was kept
+    index; // the sign of the equilibrium the path is heading for
+  double lambda, // where the path is along the ray, after the event
+    dlambda, // and the rate it moves along it
+    delta, // STEP, RETRY: the length of the step, in time
+    err0, // LNM, WOBBLE: the error in the equilibrium equations before
+    err1; // STEP, RETRY, LNM, EQ: the error after
+};
+
+#define GNMTRACE_MAGIC "GTTR"
+#define GNMTRACE_VERSION 1
+
+// Keeps the last cap records in a ring.  If given a file as well, it
+// writes out the records each time the ring fills, and at flush, so
+// that the file gets them all; the file starts with a header of the
+// magic, the version and the record size, as three 32-bit words.
+class gnmtrace {
+ public:
+  gnmtrace(int cap, FILE *f = 0) : cap(cap > 0 ? cap : 1), next(0), total(0), out(0), f(f), failed(0) {
+    ring = new gnmtracerec[this->cap];
+    if(f) {
+      int32_t head[3] = { 0, GNMTRACE_VERSION, (int32_t)sizeof(gnmtracerec) };
+      memcpy(head, GNMTRACE_MAGIC, 4);
+      failed = fwrite(head, sizeof(head), 1, f) != 1;
+    }
+  }
+  ~gnmtrace() {
+    flush();
+    delete[] ring;
+  }
+
+  inline void record(const gnmtracerec &r) {
+    ring[next] = r;
+    total++;
+    if(++next == cap) {
+      next = 0;
+      if(f)
+	write();
+    }
+  }
+
+  // writes out the records not yet written, if there is a file;
+  // returns 0 if a write has failed
+  int flush() {
+    if(f) {
+      write();
+      fflush(f);
+    }
+    return !failed;
+  }
+
+  // the records made, and how many of the last are still in the ring
+  inline long count() const { return total; }
+  inline int size() const { return total < cap ? (int)total : cap; }
+  // the k-th of those in the ring, oldest first
+  inline const gnmtracerec &get(int k) const {
+    return ring[(total < cap ? k : next + k) % cap];
+  }
+
+ private:
+  gnmtrace(const gnmtrace &);
+  gnmtrace &operator=(const gnmtrace &);
+
+  // the records since out, which are in the ring, as the file holds
+  // all before them
+  void write() {
+    long n = total - out;
+    int at = (int)(out % cap);
+    while(n > 0 && !failed) {
+      long run = cap - at < n ? cap - at : n;
+      failed = fwrite(ring + at, sizeof(gnmtracerec), run, f) != (size_t)run;
+      n -= run;
+      at = 0;
+    }
+    out = total;
+  }
+
+  int cap, next;
+  long total, out; // made, and written out
+  gnmtracerec *ring;
+  FILE *f;
+  int failed;
+};
+
+#endif
@@ -21,6 +21,10 @@
 #include "gnm.h"
 #include "nfgame.h"
 #include "makegame.h"
+#include "threadpool.h"
+#include <fstream>
+#include <string>
+#include <cstdio>
 
 // CONSTANTS
 // For explanation of constants, refer to the appropriate header file
@@ -33,6 +37,11 @@
 #define LAMBDAMIN -10.0
 #define WOBBLE 0
 #define THRESHOLD 1e-2
+#define LNMBACKTRACK 8 // halvings of an LNM step allowed with -l
+#define TURN 0.02 // radians the path may turn in a step with -a
+#define UNIQUE 1e-6 // equilibria closer than this are the same with -u
+#define CKEVERY 10 // cells between the checkpoints written with -c
+#define TRACEBUF 4096 // path records buffered before writing with -o
 
 // IPA CONSTANTS
 #define ALPHA 0.02
@@ -40,25 +49,169 @@
 
 void usage(char *name) { 
   cout << "GameTracer 0.2\n\
-usage: " << name << " [-i] [file|-r players actions gameseed] rayseed\n\
+usage: " << name << " [-i] [-m] [-b] [-l] [-a] [-p] [-k rays] [-f] [-t threads] [-u] [-d seconds]\n\
+          [-c ckfile] [-R ckfile] [-o tracefile] [-s] [file|-r players actions gameseed] rayseed\n\
 \n\
 -i:      use IPA (iterative polymatrix approximation)\n\
+-m:      use mixed-precision linear solves (faster for large games)\n\
+-b:      correct the GNM path with Broyden (quasi-Newton) updates\n\
+-l:      cut back the GNM path corrections with a line search\n\
+-a:      size the GNM steps by how sharply the path turns\n\
+-p:      predict the GNM path to second order (Hermite)\n\
+-k:      follow this many GNM rays at once, and print the equilibria\n\
+         found on any of them (not with -c, -R or -o)\n\
+-f:      stop at the first equilibrium GNM finds (with -k, on any ray)\n\
+-t:      use at most this many threads (default: one per core)\n\
+-u:      print each equilibrium GNM finds only once\n\
+-d:      give up after this many seconds, printing what was found\n\
+-c:      write the state of the GNM path to this file as it goes\n\
+-R:      carry on along the GNM path from the state in this file\n\
+-o:      record each step of the GNM path in this file (gtdump\n\
+         prints it as CSV)\n\
+-s:      print allocation and per-kernel work counts to stderr\n\
+         (needs a build with make INSTRUMENT=1), and for GNM, how\n\
+         the path corrections went\n\
 file:    read game in from file\n\
 -r:      generate a game with the specified number of players and\n\
          actions per player, with payoffs chosen randomly from [0,1]\n\
 rayseed: random seed for the perturbation ray, g\n";
 }
 
+// prints the counters of gtstats.h
+void printStats(const gtstats &st) {
+  static const char *names[GT_NKERNELS] = {
+    "payoffMatrix", "adjoint", "solve", "retract", "Pivot"
+  };
+#ifndef GT_INSTRUMENT
+  cerr << "(built without INSTRUMENT=1, so nothing was counted)\n";
+#endif
+  cerr << "allocations: " << st.allocs << ", " << st.allocbytes
+       << " bytes; peak " << st.peakbytes << " bytes\n";
+  for(int k = 0; k < GT_NKERNELS; k++)
+    cerr << setw(13) << names[k] << ": " << st.kernel[k].calls << " calls, "
+	 << st.kernel[k].flops << " flops, " << st.kernel[k].bytes << " bytes\n";
+}
+
+// prints the totals of the LNM runs
+void printLNM(const gnmlnmstats &st) {
+  cerr << "LNM: " << st.calls << " runs, " << st.converged << " converged, "
+       << st.iters << " steps, " << st.halvings << " halvings";
+  if(st.calls)
+    cerr << "; error cut by 10^" << -st.reduction / st.calls << " a run";
+  cerr << "\nLNM steps per run:";
+  for(int k = 0; k <= LNMMAX; k++)
+    cerr << " " << st.hist[k];
+  cerr << "\n";
+}
+
+// Whether a retry may start under the time limit of -d (always, with
+// none), giving it what is left of the limit.
+int timeLeft(gtcontrol &ctl, double limit, std::chrono::steady_clock::time_point start) {
+  if(!(limit > 0.0))
+    return 1;
+  if(ctl.status != GT_RUN_DONE)
+    return 0;
+  ctl.deadline = limit - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if(ctl.deadline <= 0.0) {
+    ctl.status = GT_RUN_BUDGET;
+    return 0;
+  }
+  return 1;
+}
+
+// Writes each checkpoint GNM takes to the file named by arg, by way
+// of a temporary file, so that the file always holds a whole one.
+void writeCheckpoint(void *arg, const gnmcheckpoint &ck) {
+  const char *name = (const char *)arg;
+  std::string tmp = std::string(name) + ".tmp";
+  std::vector<char> buf;
+  ck.save(buf);
+  std::ofstream out(tmp.c_str(), std::ios::binary);
+  out.write(&buf[0], buf.size());
+  out.close();
+  if(out)
+    rename(tmp.c_str(), name);
+}
+
+// Loads ck from the file; returns 0 if it cannot.
+int readCheckpoint(gnmcheckpoint &ck, const char *name) {
+  std::ifstream in(name, std::ios::binary);
+  std::vector<char> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  return !buf.empty() && ck.load(&buf[0], buf.size());
+}
+
+// prints an equilibrium as GNM finds it, and stops GNM there
+int printFirst(void *, const cvector &e, int) {
+  cout << e << endl;
+  return 0;
+}
+
 int main(int argc, char **argv) {
-  int i, seed, doipa = 0, argbase = 0;
+  int i, seed, doipa = 0, dostats = 0, argbase = 0, rays = 1;
+  double limit = 0.0; // seconds, with -d
+  char *ckfile = 0, *resumefile = 0, *tracefile = 0; // with -c, -R and -o
   gnmgame *A;
+  gnmopts gopts;
+  ipaopts iopts;
+  gnmraysopts ropts;
+  gtcontrol ctl;
+  gnmlnmstats lnm;
+  long lnmhist[LNMMAX+1];
 
   if(argc < 2) {
     usage(argv[0]);
     return -1;
   }
-  if(strcmp(argv[1],"-i") == 0) {
-    doipa = 1;
+  while(strcmp(argv[1+argbase],"-i") == 0 || strcmp(argv[1+argbase],"-m") == 0
+	|| strcmp(argv[1+argbase],"-s") == 0 || strcmp(argv[1+argbase],"-b") == 0
+	|| strcmp(argv[1+argbase],"-l") == 0 || strcmp(argv[1+argbase],"-a") == 0
+	|| strcmp(argv[1+argbase],"-p") == 0 || strcmp(argv[1+argbase],"-k") == 0
+	|| strcmp(argv[1+argbase],"-f") == 0 || strcmp(argv[1+argbase],"-t") == 0
+	|| strcmp(argv[1+argbase],"-u") == 0 || strcmp(argv[1+argbase],"-d") == 0
+	|| strcmp(argv[1+argbase],"-c") == 0 || strcmp(argv[1+argbase],"-R") == 0
+	|| strcmp(argv[1+argbase],"-o") == 0) {
+    if(argv[1+argbase][1] == 'k' || argv[1+argbase][1] == 't' || argv[1+argbase][1] == 'd'
+       || argv[1+argbase][1] == 'c' || argv[1+argbase][1] == 'R' || argv[1+argbase][1] == 'o') {
+      if(argc < 3) {
+	usage(argv[0]);
+	return -1;
+      }
+      if(argv[1+argbase][1] == 'k')
+	rays = atoi(argv[2+argbase]);
+      else if(argv[1+argbase][1] == 'd')
+	limit = atof(argv[2+argbase]);
+      else if(argv[1+argbase][1] == 'c')
+	ckfile = argv[2+argbase];
+      else if(argv[1+argbase][1] == 'R')
+	resumefile = argv[2+argbase];
+      else if(argv[1+argbase][1] == 'o')
+	tracefile = argv[2+argbase];
+      else
+	gt_set_num_threads(atoi(argv[2+argbase]));
+      if(rays < 1) {
+	usage(argv[0]);
+	return -1;
+      }
+      argbase++;
+      argc--;
+    } else if(argv[1+argbase][1] == 'i')
+      doipa = 1;
+    else if(argv[1+argbase][1] == 's')
+      dostats = 1;
+    else if(argv[1+argbase][1] == 'b')
+      gopts.broyden = 1;
+    else if(argv[1+argbase][1] == 'l')
+      gopts.backtrack = LNMBACKTRACK;
+    else if(argv[1+argbase][1] == 'a')
+      gopts.turn = TURN;
+    else if(argv[1+argbase][1] == 'p')
+      gopts.predictor = gnmopts::PREDICT_HERMITE;
+    else if(argv[1+argbase][1] == 'f')
+      ropts.first = 1;
+    else if(argv[1+argbase][1] == 'u')
+      gopts.unique = ropts.same = UNIQUE;
+    else
+      gopts.solve = iopts.solve = cmatrix::SOLVE_MIXED;
     argbase++;
     argc--;
     if(argc < 2) {
@@ -66,6 +219,10 @@ int main(int argc, char **argv) {
       return -1;
     }
   }
+  if(rays > 1 && (ckfile || resumefile || tracefile)) {
+    cout << "-c, -R and -o follow a single ray, and cannot be used with -k.\n";
+    return -1;
+  }
   if(strcmp(argv[1+argbase],"-r") == 0) {
     if(argc < 6) {
       usage(argv[0]);
@@ -87,35 +244,117 @@ int main(int argc, char **argv) {
     return -1;
   }
   
+  if(dostats) {
+    for(i = 0; i <= LNMMAX; i++)
+      lnmhist[i] = 0;
+    lnm.hist = lnmhist;
+    gopts.lnm = &lnm;
+  }
+
+  gnmcheckpoint ck; // with -c or -R, for a single GNM ray
+  if(resumefile) {
+    if(!readCheckpoint(ck, resumefile)) {
+      cout << "Unable to read checkpoint.\n";
+      delete A;
+      return -1;
+    }
+    gopts.resume = &ck;
+  }
+  if(ckfile) {
+    ck.every = CKEVERY;
+    ck.fn = writeCheckpoint;
+    ck.arg = ckfile;
+    gopts.checkpoint = &ck;
+  }
+  FILE *tf = 0; // with -o
+  gnmtrace *trace = 0;
+  if(tracefile) {
+    tf = fopen(tracefile, "wb");
+    if(!tf) {
+      cout << "Unable to open trace file.\n";
+      delete A;
+      return -1;
+    }
+    trace = new gnmtrace(TRACEBUF, tf);
+    gopts.trace = trace;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if(limit > 0.0) {
+    gopts.control = iopts.control = &ctl;
+    timeLeft(ctl, limit, start);
+  }
+
   srand48(seed);
   cvector g(A->getNumActions()); // choose a random perturbation ray
   int numEq;
+  gtstats mark = gt_stats_mark(), st; // the work of all the retries
   if(doipa) {
     cvector ans(A->getNumActions());
     cvector zh(A->getNumActions(),1.0);
+    ipaworkspace ws; // shared by the retries
     do {
       for(i = 0; i < A->getNumActions(); i++) {
 	g[i] = drand48();
       }
       g /= g.norm(); // normalized
-      numEq = IPA(*A, g, zh, ALPHA, EQERR, ans);
-  } while(numEq == 0);
+      numEq = IPA(*A, g, zh, ALPHA, EQERR, ans, ws, iopts);
+  } while(numEq == 0 && timeLeft(ctl, limit, start));
+  gt_stats_since(mark, st);
   if(numEq)
     cout << ans << endl;
   } else {
     cvector **answers;
+    gnmworkspace ws; // shared by the retries
+    cvector *G = rays > 1 ? new cvector[rays] : 0;
+    int stream = ropts.first && !G; // one ray, stopped at its first equilibrium
     do {
-      for(i = 0; i < A->getNumActions(); i++) {
-	g[i] = drand48();
+      if(G) { // a batch of rays, raced against each other
+	for(int r = 0; r < rays; r++) {
+	  G[r].resize(A->getNumActions());
+	  for(i = 0; i < A->getNumActions(); i++)
+	    G[r][i] = drand48();
+	  G[r] /= G[r].norm();
+	}
+	numEq = GNMrays(*A, G, rays, answers, STEPS, FUZZ, LNMFREQ, LNMMAX, LAMBDAMIN, WOBBLE, THRESHOLD, gopts, ropts);
+      } else {
+	for(i = 0; i < A->getNumActions(); i++) {
+	  g[i] = drand48();
+	}
+	g /= g.norm(); // normalized
+	if(stream)
+	  numEq = GNM(*A, g, printFirst, 0, STEPS, FUZZ, LNMFREQ, LNMMAX, LAMBDAMIN, WOBBLE, THRESHOLD, ws, gopts);
+	else
+	  numEq = GNM(*A, g, answers, STEPS, FUZZ, LNMFREQ, LNMMAX, LAMBDAMIN, WOBBLE, THRESHOLD, ws, gopts);
+	gopts.resume = 0; // retries start afresh
       }
-      g /= g.norm(); // normalized
-      numEq = GNM(*A, g, answers, STEPS, FUZZ, LNMFREQ, LNMMAX, LAMBDAMIN, WOBBLE, THRESHOLD);
-    } while(numEq == 0);
-    for(i = 0; i < numEq; i++) {
-      cout << *(answers[i]) << endl;
-      delete answers[i];
+      if(numEq == 0 && !stream) {
+	free(answers);
+	answers = 0; // in case there is no retry
+      }
+    } while(numEq == 0 && timeLeft(ctl, limit, start));
+    delete[] G;
+    gt_stats_since(mark, st);
+    if(!stream) {
+      for(i = 0; i < numEq; i++) {
+	cout << *(answers[i]) << endl;
+	delete answers[i];
+      }
+      free(answers);
     }
-    free(answers);
+  }
+  if(ctl.status != GT_RUN_DONE)
+    cerr << "gave up after " << limit << " seconds\n";
+  if(trace) {
+    if(!trace->flush())
+      cerr << "could not write all of " << tracefile << "\n";
+    delete trace;
+    fclose(tf);
+  }
+  if(dostats) {
+    printStats(st);
+    if(!doipa)
+      printLNM(lnm);
   }
   delete A;
 }
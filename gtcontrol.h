@@ -0,0 +1,109 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __GTCONTROL_H
+#define __GTCONTROL_H
+
+#include <atomic>
+#include <chrono>
+
+// Limits on a GNM or IPA call, passed through the control member of
+// gnmopts or ipaopts.  Neither algorithm is bound to finish: a GNM path
+// can circle without end, and IPA can fail to settle.  A call that
+// reaches a limit returns what it has so far (GNM, the equilibria
+// found; IPA, 0) and says why in status.
+//
+// A limit of 0 is no limit.  The counts and the clock start afresh at
+// each call; the limits are checked once a step, so a call may run
+// over its deadline by one step.
+enum gtrunstatus {
+  GT_RUN_DONE = 0, // the call ran to its end
+  GT_RUN_BUDGET = 1, // it stopped on a deadline or a count
+  GT_RUN_CANCELLED = 2 // it stopped on *cancel
+};
+
+struct gtcontrol {
+  double deadline; // seconds of wall-clock time
+  long maxsteps, // GNM steps along the path, in all cells
+    maxsupport, // GNM support changes (cells the path passes through)
+    maxiters; // IPA iterations
+
+  // if set, the call stops once *cancel is nonzero, which another
+  // thread may do at any time
+  std::atomic<int> *cancel;
+
+  // filled in by the call: how it ended, and what it used
+  gtrunstatus status;
+  long steps, supports, iters;
+  double seconds;
+
+  gtcontrol() : deadline(0.0), maxsteps(0), maxsupport(0), maxiters(0), cancel(0),
+    status(GT_RUN_DONE), steps(0), supports(0), iters(0), seconds(0.0) {}
+};
+
+// Counts a call's work against c, if it is set.  Each of step,
+// support and iter counts one and returns 0 once the call is to stop,
+// having set c->status; the destructor records what was used.
+class gtbudget {
+ public:
+  gtbudget(gtcontrol *c) : c(c) {
+    if(!c)
+      return;
+    c->status = GT_RUN_DONE;
+    c->steps = c->supports = c->iters = 0;
+    start = std::chrono::steady_clock::now();
+  }
+  ~gtbudget() {
+    if(c)
+      c->seconds = elapsed();
+  }
+
+  inline int step() { return !c || (check(c->steps, c->maxsteps) && live() && ++c->steps); }
+  inline int support() { return !c || (check(c->supports, c->maxsupport) && live() && ++c->supports); }
+  inline int iter() { return !c || (check(c->iters, c->maxiters) && live() && ++c->iters); }
+
+ private:
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  // whether one more may be done, with n done so far
+  int check(long n, long most) {
+    if(most > 0 && n >= most) {
+      c->status = GT_RUN_BUDGET;
+      return 0;
+    }
+    return 1;
+  }
+  int live() {
+    if(c->cancel && c->cancel->load()) {
+      c->status = GT_RUN_CANCELLED;
+      return 0;
+    }
+    if(c->deadline > 0.0 && elapsed() > c->deadline) {
+      c->status = GT_RUN_BUDGET;
+      return 0;
+    }
+    return 1;
+  }
+
+  gtcontrol *c;
+  std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// gtdump prints a GNM path trace, as written by gt -o, as CSV: a
+// header line, then a line for each record (see gnmtrace.h).
+
+#include <cstdio>
+#include <cstring>
+#include "gnmtrace.h"
+
+static const char *kinds[] = {
+  "step", "retry", "lnm", "enter", "leave", "eq", "wobble"
+};
+
+int main(int argc, char **argv) {
+  if(argc != 2) {
+    fprintf(stderr, "usage: %s tracefile\n", argv[0]);
+    return -1;
+  }
+  FILE *f = fopen(argv[1], "rb");
+  if(!f) {
+    fprintf(stderr, "Unable to open %s.\n", argv[1]);
+    return -1;
+  }
+
+  int32_t head[3];
+  if(fread(head, sizeof(head), 1, f) != 1 || memcmp(head, GNMTRACE_MAGIC, 4) != 0
+     || head[1] != GNMTRACE_VERSION || head[2] != (int32_t)sizeof(gnmtracerec)) {
+    fprintf(stderr, "%s is not a GNM trace.\n", argv[1]);
+    fclose(f);
+    return -1;
+  }
+
+  printf("cell,kind,step,action,index,lambda,dlambda,delta,err0,err1\n");
+  gnmtracerec r;
+  while(fread(&r, sizeof(r), 1, f) == 1) {
+    if(r.kind >= 0 && r.kind < (int32_t)(sizeof(kinds) / sizeof(kinds[0])))
+      printf("%lld,%s,", (long long)r.cell, kinds[r.kind]);
+    else
+      printf("%lld,%d,", (long long)r.cell, r.kind);
+    printf("%d,%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g\n", r.step, r.action, r.index,
+	   r.lambda, r.dlambda, r.delta, r.err0, r.err1);
+  }
+  fclose(f);
+  return 0;
+}
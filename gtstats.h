@@ -0,0 +1,125 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __GTSTATS_H
+#define __GTSTATS_H
+
+// Work counters for the numeric core, kept per thread.  They are only
+// updated when the code is compiled with GT_INSTRUMENT defined (make
+// INSTRUMENT=1); otherwise the macros below compile to nothing and the
+// counters stay at zero.
+//
+// Allocation counts cover the heap storage of cvector and cmatrix
+// (vectors and matrices small enough to be stored inline are not
+// counted).  The FLOP and byte counts of the kernels come from the
+// operation counts of the loops they run, not from hardware counters;
+// bytes is the matrix and vector data each kernel reads and writes,
+// assuming none of it stays in cache.
+
+enum {
+  GT_KPAYOFF = 0, // gnmgame::payoffMatrix (for nfgame, also getMixedPayoff)
+  GT_KADJOINT, // cmatrix::adjoint
+  GT_KSOLVE, // cmatrix::solve and cmatrixlu
+  GT_KRETRACT, // gnmgame::retract
+  GT_KPIVOT, // Lemke-Howson pivots
+  GT_NKERNELS
+};
+
+struct gtkernelstats {
+  long calls;
+  double flops, bytes;
+};
+
+struct gtstats {
+  long allocs; // heap allocations
+  double allocbytes; // bytes in them
+  double curbytes; // bytes allocated and not yet freed
+  double peakbytes; // the most curbytes has been
+  gtkernelstats kernel[GT_NKERNELS];
+};
+
+// this thread's counters
+extern thread_local gtstats gt_stats;
+
+// The counters a call adds are found by taking a mark before it and
+// passing the mark to gt_stats_since afterwards, which fills dest with
+// the difference.  In dest, curbytes is the net growth and peakbytes
+// the peak above the bytes held when the mark was taken.
+inline gtstats gt_stats_mark() {
+  gtstats mark = gt_stats;
+  gt_stats.peakbytes = gt_stats.curbytes;
+  return mark;
+}
+
+inline void gt_stats_since(const gtstats &mark, gtstats &dest) {
+  gtstats &s = gt_stats;
+  dest.allocs = s.allocs - mark.allocs;
+  dest.allocbytes = s.allocbytes - mark.allocbytes;
+  dest.curbytes = s.curbytes - mark.curbytes;
+  dest.peakbytes = s.peakbytes - mark.curbytes;
+  for(int k = 0; k < GT_NKERNELS; k++) {
+    dest.kernel[k].calls = s.kernel[k].calls - mark.kernel[k].calls;
+    dest.kernel[k].flops = s.kernel[k].flops - mark.kernel[k].flops;
+    dest.kernel[k].bytes = s.kernel[k].bytes - mark.kernel[k].bytes;
+  }
+  if(s.peakbytes < mark.peakbytes)
+    s.peakbytes = mark.peakbytes;
+}
+
+#ifdef GT_INSTRUMENT
+
+inline void gt_stat_alloc(double bytes) {
+  gtstats &s = gt_stats;
+  s.allocs++;
+  s.allocbytes += bytes;
+  s.curbytes += bytes;
+  if(s.curbytes > s.peakbytes)
+    s.peakbytes = s.curbytes;
+}
+
+// one call of kernel k, doing the given work
+inline void gt_stat_call(int k, double flops, double bytes) {
+  gtkernelstats &s = gt_stats.kernel[k];
+  s.calls++;
+  s.flops += flops;
+  s.bytes += bytes;
+}
+
+// more work for the current call of kernel k
+inline void gt_stat_work(int k, double flops, double bytes) {
+  gtkernelstats &s = gt_stats.kernel[k];
+  s.flops += flops;
+  s.bytes += bytes;
+}
+
+#define GT_STAT_ALLOC(bytes) gt_stat_alloc(bytes)
+#define GT_STAT_FREE(bytes) (gt_stats.curbytes -= (bytes))
+#define GT_STAT_CALL(k, flops, bytes) gt_stat_call(k, flops, bytes)
+#define GT_STAT_WORK(k, flops, bytes) gt_stat_work(k, flops, bytes)
+
+#else
+
+#define GT_STAT_ALLOC(bytes) ((void)0)
+#define GT_STAT_FREE(bytes) ((void)0)
+#define GT_STAT_CALL(k, flops, bytes) ((void)0)
+#define GT_STAT_WORK(k, flops, bytes) ((void)0)
+
+#endif
+
+#endif
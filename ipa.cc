@@ -32,38 +32,74 @@
 // fuzz: the cutoff accuracy for an equilibrium after which the algorithm
 //       stops refining it
 // ans: a pre-allocated vector in which the equilibrium will be stored
+// opts: further settings, described in ipa.h.
 
-int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans) {
+void ipaworkspace::resize(int N, int M) {
+  if(N == this->N && M == this->M)
+    return;
+  DG.reshape(M,M);
+  T.reshape(M+N,M+N+2);
+  T2.reshape(M+N,M+N);
+  d.resize(M);
+  u.resize(M);
+  y.resize(M);
+  yh.resize(M);
+  s.resize(M);
+  so.resize(M);
+  sh.resize(M);
+  sho.resize(M);
+  z.resize(M);
+  zt.resize(M);
+  ymn1.resize(M+N);
+  ymn2.resize(M+N);
+  delete[] lhbasis;
+  lhbasis = new int[M+N];
+  this->N = N;
+  this->M = M;
+}
+
+int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans, const ipaopts &opts) {
+  ipaworkspace ws;
+  return IPA(A, g, zh, alpha, fuzz, ans, ws, opts);
+}
+
+static int IPArun(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans, ipaworkspace &ws, const ipaopts &opts);
+
+int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans, ipaworkspace &ws, const ipaopts &opts) {
+  if(!opts.stats)
+    return IPArun(A, g, zh, alpha, fuzz, ans, ws, opts);
+  gtstats mark = gt_stats_mark();
+  int ret = IPArun(A, g, zh, alpha, fuzz, ans, ws, opts);
+  gt_stats_since(mark, *opts.stats);
+  return ret;
+}
+
+static int IPArun(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans, ipaworkspace &ws, const ipaopts &opts) {
   int N = A.getNumPlayers(),
     M = A.getNumActions(), // For easy reference
     i,j,n,bestAction,B, // utility vars
-    b[M], // current support
     Im[N], // best actions in perturbed game
     firstIteration = 1; 
 
   double bestPayoff,l; // utility vars
 
-  cmatrix DG(M,M), 
-    O(N,N,0), // matrix of zeroes
-    S(N,M,0), // 
-    I(M+N,M+N,1,1), // identity
-    T(M+N,M+N+2,0), // tableau for Lemke-Howson
-    T2(M+N,M+N,0); // submatrix of tableau used if Lemke-Howson is unnecessary
-
-  cvector d(M), // diff
-    u(M),
-    y(M), // old z
-    yh(M), // old zh
-    s(M), // current strategy
-    so(M), // old strategy
-    sh(M), // approximate strategy
-    sho(M,0), // old approximate strategy
-    z(M), // current point in game-space
-    zt(M), // next approximating point
-    ym1(M), // utility vars
-    ym2(M), 
-    ymn1(M+N),
-    ymn2(M+N);
+  ws.resize(N,M);
+  cmatrix &DG = ws.DG, 
+    &T = ws.T, // tableau for Lemke-Howson
+    &T2 = ws.T2; // submatrix of tableau used if Lemke-Howson is unnecessary
+
+  cvector &d = ws.d, // diff
+    &u = ws.u,
+    &y = ws.y, // old z
+    &yh = ws.yh, // old zh
+    &s = ws.s, // current strategy
+    &so = ws.so, // old strategy
+    &sh = ws.sh, // approximate strategy
+    &sho = ws.sho, // old approximate strategy
+    &z = ws.z, // current point in game-space
+    &zt = ws.zt, // next approximating point
+    &ymn1 = ws.ymn1, // utility vars
+    &ymn2 = ws.ymn2;
 
   // Find the best action for each player when the game is highly perturbed
   for(n = 0; n < N; n++) {
@@ -83,8 +119,12 @@ int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector
   so = sh;
   sho = sh;
   yh = zh;
+  ws.lhbasis[0] = 0; // no basis to warm start from yet
 
+  gtbudget budget(opts.control);
   while(1) {
+    if(!budget.iter())
+      return 0;
     A.payoffMatrix(DG,sh,0.0);
     DG /= (double)(N-1); // find the Jacobian of the approximating bimatrix game
 
@@ -136,8 +176,10 @@ int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector
       ymn1[i] = 1;
     }
     
-    // find equilibrium assuming current support
-    T2.solve(ymn1, ymn2);
+    // find equilibrium assuming current support; as with
+    // cmatrix::solve, a singular T2 leaves the right hand side
+    if(!ws.T2lu.factor(T2, opts.solve) || !ws.T2lu.solve(ymn1, ymn2))
+      ymn2 = ymn1;
     
     for(i = 0; i < M; i++)
       s[i] = ymn2[i];
@@ -150,7 +192,7 @@ int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector
       }
     }
     if(flag) { // update support and solve
-      A.LemkeHowson(s,T,Im);
+      A.LemkeHowson(s,T,Im,opts.lh,&ws.Tsp,&ws.Trev,opts.warmlh ? ws.lhbasis : 0);
     } else {
       // limit to current support
       for(i = 0; i < M; i++) {
@@ -173,59 +215,39 @@ int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector
     
     // see if angle between z-sh and zh-sh is acute; if so, scale zh.
 
-    u = zh;
-    u -= sh;
+    u = zh - sh;
 
-    ym1 = z;
-    ym1 -= sh;
     double unorm2 = u.norm2();
-    l = (unorm2 > 0.0) ? (ym1 * u) / unorm2 : 1.0; // dot product with guard for u==0
+    l = (unorm2 > 0.0) ? (u * (z - sh)) / unorm2 : 1.0; // dot product with guard for u==0
     if(l <= 0.0 || B) {
-      zh = u;
-      zh *= l;
-      zh += sh;
-      yh -= sho;
-      yh *= l;
-      yh += sho;
+      zh = u*l + sh;
+      yh = (yh - sho)*l + sho;
     }
     
-    ym1 = z;
-    ym1 -= zh;
-    ym2 = s;
-    ym2 -= sh;
     // if z and zh or s and sh are close enough, 
     // we've got an approximate equilibrium, so we can quit
-    if(N <= 2 || (ym1.norm() < fuzz || ym2.norm() < fuzz)) {
+    if(N <= 2 || ((z - zh).norm() < fuzz || (s - sh).norm() < fuzz)) {
       ans = s;
       A.payoffMatrix(DG,s,0.0);
       return 1;
     }
-    ym1 = z;
+    zt = z;
     // do a first-order approximation on the first iteration,
     // and subsequently do a second-order approximation
     if(!firstIteration) {
-      d = z;
-      d -= zh;
-      d -= y;
-      d += yh;
+      d = z - zh - y + yh;
       // Rule of false position
       if(B && d.absmax() > fuzz) {
 	for(i = 0; i < M; i++) {
-	  if(fabs(d[i]) > fuzz) ym1[i] = (yh[i] * z[i] - zh[i] * y[i])/d[i];
+	  if(fabs(d[i]) > fuzz) zt[i] = (yh[i] * z[i] - zh[i] * y[i])/d[i];
 	}
-      } else {
-      // Only do a first-order approximation
-	ym1 = z;
       }
+      // otherwise only do a first-order approximation
     } else {
       firstIteration = 0;
-      ym1 = z;
     }
-    zt = ym1;
-    zt *= alpha / (1-alpha);
-    zt += zh;
-    zt *= (1-alpha);
-    // zt = ym1*alpha + zh * (1-alpha)
+    zt = (zt * (alpha / (1-alpha)) + zh) * (1-alpha);
+    // zt = zt*alpha + zh * (1-alpha)
 
     // Update values
     so = s;
@@ -22,7 +22,55 @@
 
 #include "cmatrix.h"
 #include "gnmgame.h"
+#include "gtcontrol.h"
 
-int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans); 
+// Settings for IPA beyond its positional parameters (see ipa.cc).  The
+// defaults give the original algorithm.
+struct ipaopts {
+  // how the linear system for a fixed support is solved
+  cmatrix::solvemode solve;
+
+  // how Lemke-Howson pivots when the support has to change (see
+  // gnmgame::lhmode); LH_DENSE unless set
+  gnmgame::lhmode lh;
+
+  // if set, each Lemke-Howson call after the first in an IPA run first
+  // tries the final basis of the one before (see gnmgame::LemkeHowson)
+  int warmlh;
+
+  // if set, receives the work counted during the call (see gtstats.h)
+  gtstats *stats;
+
+  // if set, limits the call's time and iterations, and can cancel it
+  // (see gtcontrol.h); a call stopped this way returns 0
+  gtcontrol *control;
+
+  ipaopts() : solve(cmatrix::SOLVE_DOUBLE), lh(gnmgame::LH_DENSE), warmlh(0), stats(0), control(0) {}
+};
+
+// The matrices and vectors IPA works in; see gnmworkspace.
+class ipaworkspace {
+ public:
+  ipaworkspace() : N(0), M(0), lhbasis(0) {}
+  ~ipaworkspace() { delete[] lhbasis; }
+
+  // makes room for games with N players and M actions in all
+  void resize(int N, int M);
+
+  int N, M;
+  cmatrix DG,
+    T, // tableau for Lemke-Howson
+    T2; // submatrix of tableau used if Lemke-Howson is unnecessary
+  cvector d, u, y, yh, s, so, sh, sho, z, zt, ymn1, ymn2;
+  cmatrixlu T2lu; // factors of T2
+  lhsparse Tsp; // T in sparse form, when Lemke-Howson pivots that way
+  lhrevised Trev; // the basis, when Lemke-Howson uses the revised method
+  int *lhbasis; // the last basis Lemke-Howson ended on
+};
+
+int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans, const ipaopts &opts = ipaopts()); 
+
+// The same, working in ws rather than in buffers of its own.
+int IPA(gnmgame &A, cvector &g, cvector &zh, double alpha, double fuzz, cvector &ans, ipaworkspace &ws, const ipaopts &opts = ipaopts());
 
 #endif
@@ -50,6 +50,8 @@ void nfgame::payoffMatrix(cmatrix &dest, cvector &s, double fuzz) {
   double fuzzcount;
   double m[blockSize[numPlayers]];
   double local[maxActions*maxActions];
+  // the work is counted in scaleMatrix, and in the copies of m below
+  GT_STAT_CALL(GT_KPAYOFF, 0, 8.0*numActions*numActions);
   for(rown = 0; rown < numPlayers; rown++) {
     for(coln = 0; coln < numPlayers; coln++) {
       if(rown == coln) {
@@ -63,6 +65,7 @@ void nfgame::payoffMatrix(cmatrix &dest, cvector &s, double fuzz) {
       } else {
 	// set m to be the payoffs for player rown
 	memcpy(m, payoffs.values() + rown * blockSize[numPlayers], blockSize[numPlayers] * sizeof(double));
+	GT_STAT_WORK(GT_KPAYOFF, 0, 16.0*blockSize[numPlayers]);
 	localPayoffMatrix(local, rown, coln, s, m, numPlayers-1);
 	for(rowi = firstAction(rown); rowi < lastAction(rown); rowi++) {
 	  for(coli = firstAction(coln); coli < lastAction(coln); coli++) {
@@ -78,6 +81,17 @@ void nfgame::payoffMatrix(cmatrix &dest, cvector &s, double fuzz) {
   }
 }
 
+void nfgame::payoffVector(cvector &dest, cvector &s) {
+  double m[blockSize[numPlayers]];
+  // as in payoffMatrix, but one pass over each player's payoffs
+  // gives all of that player's entries
+  GT_STAT_CALL(GT_KPAYOFF, 0, 8.0*numActions);
+  for(int n = 0; n < numPlayers; n++) {
+    memcpy(m, payoffs.values() + n * blockSize[numPlayers], blockSize[numPlayers] * sizeof(double));
+    GT_STAT_WORK(GT_KPAYOFF, 0, 16.0*blockSize[numPlayers]);
+    localPayoffVector(dest.values() + firstAction(n), n, s, m, numPlayers-1);
+  }
+}
 
 //assumes m = memcpy(m, payoffs + blockSize[numPlayers] * player1, blockSize[numPlayers]*sizeof(double)), player1 != player2
 //i.e. m points to payoff cmatrix for the desired player
@@ -110,10 +124,12 @@ double *nfgame::scaleMatrix(cvector &s, double *m, int n) {
 	for(j = curbase; j < curbase+blockSize[n]; j++) {
 	  m[j] *= scale;
 	}
+	GT_STAT_WORK(GT_KPAYOFF, blockSize[n], 16.0*blockSize[n]);
       } else {
 	for(j = 0; j < blockSize[n]; j++) {
 	  m[newbase + j] += scale * m[curbase+j];
 	}
+	GT_STAT_WORK(GT_KPAYOFF, 2.0*blockSize[n], 24.0*blockSize[n]);
       }
     }
   }
@@ -40,6 +40,7 @@ class nfgame : public gnmgame {
 
   double getMixedPayoff(int player, cvector &s);
   void payoffMatrix(cmatrix &dest, cvector &s, double fuzz);
+  void payoffVector(cvector &dest, cvector &s);
 
 
  private:
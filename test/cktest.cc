@@ -0,0 +1,151 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Checks the dense kernels of ckernel.h against their scalar _ref
+// versions, under every instruction set ck_set_isa can select on this
+// machine.  The sizes are ragged (not multiples of any vector width)
+// and the operands start off their alignment, so the edge and
+// remainder code is exercised as well as the full tiles.  Exits 0 if
+// every kernel agrees with the reference.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "ckernel.h"
+
+static int failures = 0;
+static const char *isaname[] = { "scalar", "avx2", "avx512" };
+
+static double rnd() {
+  return 2.0 * drand48() - 1.0;
+}
+
+// whether x, from the kernel, is within tol*scale of r, from the reference
+static void check(const char *what, int isa, int i, double x, double r, double scale, double tol) {
+  if(!(fabs(x - r) <= tol * scale)) {
+    if(failures < 20)
+      printf("%s (%s): entry %d is %.17g, reference %.17g\n", what, isaname[isa], i, x, r);
+    failures++;
+  }
+}
+
+static void testGemm(int isa, int m, int n, int k, double alpha, double beta) {
+  int lda = k + 3, ldb = n + 5, ldc = n + 1;
+  std::vector<double> A(m*lda + 1), B(k*ldb + 1), C(m*ldc + 1), R;
+  for(size_t i = 0; i < A.size(); i++) A[i] = rnd();
+  for(size_t i = 0; i < B.size(); i++) B[i] = rnd();
+  for(size_t i = 0; i < C.size(); i++) C[i] = beta == 0.0 ? NAN : rnd();
+  R = C;
+  ck_gemm(m, n, k, alpha, &A[1], lda, &B[1], ldb, beta, &C[1], ldc);
+  ck_gemm_ref(m, n, k, alpha, &A[1], lda, &B[1], ldb, beta, &R[1], ldc);
+  for(int i = 0; i < m; i++)
+    for(int j = 0; j < n; j++)
+      check("ck_gemm", isa, i*ldc + j, C[1 + i*ldc + j], R[1 + i*ldc + j], k + 1.0, 1e-14);
+}
+
+static void testSgemm(int isa, int m, int n, int k, float alpha, float beta) {
+  int lda = k + 1, ldb = n + 7, ldc = n + 2;
+  std::vector<float> A(m*lda + 1), B(k*ldb + 1), C(m*ldc + 1), R;
+  for(size_t i = 0; i < A.size(); i++) A[i] = (float)rnd();
+  for(size_t i = 0; i < B.size(); i++) B[i] = (float)rnd();
+  for(size_t i = 0; i < C.size(); i++) C[i] = beta == 0.0f ? NAN : (float)rnd();
+  R = C;
+  ck_sgemm(m, n, k, alpha, &A[1], lda, &B[1], ldb, beta, &C[1], ldc);
+  ck_sgemm_ref(m, n, k, alpha, &A[1], lda, &B[1], ldb, beta, &R[1], ldc);
+  for(int i = 0; i < m; i++)
+    for(int j = 0; j < n; j++)
+      check("ck_sgemm", isa, i*ldc + j, C[1 + i*ldc + j], R[1 + i*ldc + j], k + 1.0, 1e-6);
+}
+
+static void testGemv(int isa, int m, int n) {
+  int lda = n + 3;
+  std::vector<double> A(m*lda + 1), x(n + 1), y(m + 1), r(m + 1);
+  for(size_t i = 0; i < A.size(); i++) A[i] = rnd();
+  for(size_t i = 0; i < x.size(); i++) x[i] = rnd();
+  ck_gemv(m, n, &A[1], lda, &x[1], &y[1]);
+  ck_gemv_ref(m, n, &A[1], lda, &x[1], &r[1]);
+  for(int i = 0; i < m; i++)
+    check("ck_gemv", isa, i, y[1 + i], r[1 + i], n, 1e-14);
+}
+
+static void testVector(int isa, int n) {
+  std::vector<double> x(n + 1), y(n + 1), r;
+  std::vector<float> fx(n + 1), fy(n + 1), fr;
+  double a = rnd(), b = rnd(), c = 1.0 / (0.5 + drand48());
+  int i;
+
+  for(i = 0; i <= n; i++) {
+    x[i] = rnd();
+    y[i] = rnd();
+    fx[i] = (float)x[i];
+    fy[i] = (float)y[i];
+  }
+  r = y;
+  ck_axpy(n, a, &x[1], &y[1]);
+  ck_axpy_ref(n, a, &x[1], &r[1]);
+  for(i = 0; i < n; i++)
+    check("ck_axpy", isa, i, y[1 + i], r[1 + i], 1.0, 1e-15);
+
+  fr = fy;
+  ck_saxpy(n, (float)a, &fx[1], &fy[1]);
+  ck_saxpy_ref(n, (float)a, &fx[1], &fr[1]);
+  for(i = 0; i < n; i++)
+    check("ck_saxpy", isa, i, fy[1 + i], fr[1 + i], 1.0, 1e-6);
+
+  r = y;
+  ck_pivot(n, a, b, c, &x[1], &y[1]);
+  ck_pivot_ref(n, a, b, c, &x[1], &r[1]);
+  for(i = 0; i < n; i++)
+    check("ck_pivot", isa, i, y[1 + i], r[1 + i], c, 1e-15);
+}
+
+int main() {
+  static const int gemms[][3] = {
+    { 1, 1, 1 }, { 3, 5, 7 }, { 17, 19, 23 }, { 37, 53, 29 },
+    { 67, 131, 71 }, { 129, 33, 257 }, { 200, 301, 97 }
+  };
+  static const int gemvs[][2] = {
+    { 1, 1 }, { 5, 7 }, { 9, 8 }, { 13, 33 }, { 61, 127 }, { 130, 257 }
+  };
+  int tried = 0;
+
+  srand48(1);
+  for(int isa = CK_ISA_SCALAR; isa <= CK_ISA_AVX512; isa++) {
+    if(ck_set_isa(isa) != isa) {
+      printf("%s: not supported here, skipped\n", isaname[isa]);
+      continue;
+    }
+    tried++;
+    int before = failures;
+    for(size_t t = 0; t < sizeof(gemms) / sizeof(gemms[0]); t++) {
+      testGemm(isa, gemms[t][0], gemms[t][1], gemms[t][2], 1.0, 0.0);
+      testGemm(isa, gemms[t][0], gemms[t][1], gemms[t][2], -0.75, 1.5);
+      testSgemm(isa, gemms[t][0], gemms[t][1], gemms[t][2], 1.0f, 0.0f);
+      testSgemm(isa, gemms[t][0], gemms[t][1], gemms[t][2], 0.5f, -2.0f);
+    }
+    for(size_t t = 0; t < sizeof(gemvs) / sizeof(gemvs[0]); t++)
+      testGemv(isa, gemvs[t][0], gemvs[t][1]);
+    for(int n = 0; n <= 70; n++)
+      testVector(isa, n);
+    testVector(isa, 1001);
+    printf("%s: %s\n", isaname[isa], failures == before ? "ok" : "FAILED");
+  }
+  return failures || !tried;
+}
@@ -0,0 +1,113 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Runs GNM and IPA on a few random games, as gt does, and checks that
+// neither deep-copies a cvector or cmatrix: the counters of the copy
+// constructors (cvector::num_vec_copies, cmatrix::num_mat_copies) must
+// still be 0 afterwards.  Temporaries are meant to be moved or built in
+// place, so a copy here is a regression.  It also checks that a
+// std::vector of them moves its elements when it grows, which it does
+// only if their moves are noexcept.  Exits 0 if no copy was made.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "gnm.h"
+#include "ipa.h"
+#include "makegame.h"
+
+static int failures = 0;
+
+// reports the copies made since the counters were last cleared
+static void check(const char *what, int players, int actions) {
+  if(cvector::num_vec_copies || cmatrix::num_mat_copies) {
+    printf("%s on %d players, %d actions: %d cvector and %d cmatrix copies\n", what,
+	   players, actions, cvector::num_vec_copies, cmatrix::num_mat_copies);
+    failures++;
+  }
+  cvector::num_vec_copies = cmatrix::num_mat_copies = 0;
+}
+
+static void randomRay(cvector &g) {
+  for(int i = 0; i < g.getm(); i++)
+    g[i] = drand48();
+  g /= g.norm();
+}
+
+static int countEq(void *, const cvector &, int) {
+  return 0;
+}
+
+// grows vectors of small (inline) and large (heap) cvectors and
+// cmatrices through several reallocations
+static void growVectors() {
+  std::vector<cvector> vs;
+  std::vector<cmatrix> ms;
+  cvector::num_vec_copies = cmatrix::num_mat_copies = 0;
+  for(int i = 0; i < 40; i++) {
+    vs.push_back(cvector(i % 2 ? 3 : 100, 1.0));
+    ms.push_back(cmatrix(i % 2 ? 2 : 30, 3));
+  }
+  for(int i = 0; i < 40; i++)
+    if(vs[i].getm() != (i % 2 ? 3 : 100) || vs[i][2] != 1.0 || ms[i].getm() != (i % 2 ? 2 : 30)) {
+      printf("std::vector growth lost element %d\n", i);
+      failures++;
+    }
+  if(cvector::num_vec_copies || cmatrix::num_mat_copies) {
+    printf("std::vector growth: %d cvector and %d cmatrix copies\n",
+	   cvector::num_vec_copies, cmatrix::num_mat_copies);
+    failures++;
+  }
+}
+
+int main() {
+  growVectors();
+  static const int sizes[][2] = { {2, 2}, {2, 5}, {3, 3}, {4, 2}, {5, 3} };
+  for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    int players = sizes[s][0], actions = sizes[s][1];
+    nfgame *A = makeRandomNFGame(players, actions, 7 + s);
+    int M = A->getNumActions();
+    srand48(s + 1);
+    cvector g(M);
+    cvector::num_vec_copies = cmatrix::num_mat_copies = 0;
+
+    gnmworkspace gws;
+    cvector **answers;
+    randomRay(g);
+    int numEq = GNM(*A, g, answers, 100, 1e-12, 3, 10, -10.0, 0, 1e-2, gws);
+    check("GNM", players, actions);
+    for(int i = 0; i < numEq; i++)
+      delete answers[i];
+    free(answers);
+
+    randomRay(g);
+    GNM(*A, g, countEq, 0, 100, 1e-12, 3, 10, -10.0, 0, 1e-2, gws);
+    check("GNM with a callback", players, actions);
+
+    ipaworkspace iws;
+    cvector ans(M), zh(M, 1.0);
+    randomRay(g);
+    IPA(*A, g, zh, 0.02, 1e-6, ans, iws);
+    check("IPA", players, actions);
+
+    delete A;
+  }
+  printf("copies: %s\n", failures ? "FAILED" : "ok");
+  return failures != 0;
+}
@@ -0,0 +1,160 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "threadpool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One call to gt_parallel_for.  It lives on the caller's stack; workers
+// register in users while they hold a pointer to it, and the caller
+// does not return until users is back to 0.
+struct gtjob {
+  gt_taskfn fn;
+  void *arg;
+  int end, grain;
+  std::atomic<int> next;
+  int users;
+  gtjob *link;
+};
+
+static std::mutex poolLock;
+static std::condition_variable poolWork, poolDone;
+static std::vector<std::thread> poolThreads;
+static gtjob *poolJobs = 0; // jobs that may still have unclaimed chunks
+// these two are written under poolLock, but read without it by
+// gt_parallel_for and gt_get_num_threads
+static std::atomic<int> poolSize(0); // 0 until started
+static std::atomic<int> poolWanted(0);
+static bool poolStop = false;
+
+// runs chunks of j until none are left
+static void runChunks(gtjob *j) {
+  int b;
+  while((b = j->next.fetch_add(j->grain)) < j->end)
+    j->fn(j->arg, b, b + j->grain < j->end ? b + j->grain : j->end);
+}
+
+static void worker() {
+  std::unique_lock<std::mutex> lk(poolLock);
+  while(1) {
+    gtjob *j;
+    for(j = poolJobs; j; j = j->link)
+      if(j->next.load() < j->end)
+	break;
+    if(!j) {
+      if(poolStop)
+	return;
+      poolWork.wait(lk);
+      continue;
+    }
+    j->users++;
+    lk.unlock();
+    runChunks(j);
+    lk.lock();
+    if(--j->users == 0)
+      poolDone.notify_all();
+  }
+}
+
+static void stopPool() {
+  {
+    std::lock_guard<std::mutex> lk(poolLock);
+    poolStop = true;
+  }
+  poolWork.notify_all();
+  for(size_t i = 0; i < poolThreads.size(); i++)
+    poolThreads[i].join();
+  std::lock_guard<std::mutex> lk(poolLock);
+  poolThreads.clear();
+  poolStop = false;
+  poolSize = 0;
+}
+
+// the workers are joined at exit, before the statics above go away
+struct gtpoolguard {
+  ~gtpoolguard() { stopPool(); }
+};
+static gtpoolguard poolGuard;
+
+static int wantedThreads() {
+  static int hw = (int)std::thread::hardware_concurrency();
+  int n = poolWanted.load();
+  if(n > 0)
+    return n;
+  return hw > 0 ? hw : 1;
+}
+
+static void startPool() {
+  std::lock_guard<std::mutex> lk(poolLock);
+  if(poolSize)
+    return;
+  poolSize = wantedThreads();
+  for(int i = 1; i < poolSize; i++)
+    poolThreads.push_back(std::thread(worker));
+}
+
+void gt_set_num_threads(int n) {
+  stopPool();
+  std::lock_guard<std::mutex> lk(poolLock);
+  poolWanted = n > 0 ? n : 0;
+}
+
+int gt_get_num_threads() {
+  int n = poolSize.load();
+  return n ? n : wantedThreads();
+}
+
+void gt_parallel_for(int begin, int end, int grain, gt_taskfn fn, void *arg) {
+  if(grain < 1)
+    grain = 1;
+  if(end - begin <= grain || gt_get_num_threads() <= 1) {
+    for(int b = begin; b < end; b += grain)
+      fn(arg, b, b + grain < end ? b + grain : end);
+    return;
+  }
+  if(!poolSize)
+    startPool();
+
+  gtjob j;
+  j.fn = fn;
+  j.arg = arg;
+  j.end = end;
+  j.grain = grain;
+  j.next = begin;
+  j.users = 0;
+  {
+    std::lock_guard<std::mutex> lk(poolLock);
+    j.link = poolJobs;
+    poolJobs = &j;
+  }
+  poolWork.notify_all();
+
+  runChunks(&j);
+
+  std::unique_lock<std::mutex> lk(poolLock);
+  gtjob **p = &poolJobs;
+  while(*p != &j)
+    p = &(*p)->link;
+  *p = j.link;
+  while(j.users > 0)
+    poolDone.wait(lk);
+}
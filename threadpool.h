@@ -0,0 +1,55 @@
+/* Copyright 2026 The GameTracer contributors
+ *
+ * This file is part of GameTracer.
+ *
+ * GameTracer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GameTracer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GameTracer; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __THREADPOOL_H
+#define __THREADPOOL_H
+
+// The worker threads shared by the numeric code.  The pool is started
+// the first time a parallel loop needs it.
+//
+// gt_parallel_for splits a range into chunks and runs them on the
+// workers and on the calling thread, returning when all are done.  Any
+// number of threads may call it at once, including from inside another
+// parallel loop: each call is its own job, and the caller always works
+// through its own job, so it never waits for workers busy elsewhere.
+
+// Number of threads a parallel loop may use, counting the caller.  0
+// means one per hardware thread.  Must not be called while parallel
+// loops are running.
+void gt_set_num_threads(int n);
+int gt_get_num_threads();
+
+typedef void (*gt_taskfn)(void *arg, int begin, int end);
+
+// calls fn(arg, b, e) over disjoint [b,e) covering [begin,end), each at
+// most grain long
+void gt_parallel_for(int begin, int end, int grain, gt_taskfn fn, void *arg);
+
+template <class F>
+static void gt_parallel_call(void *arg, int begin, int end) {
+  (*(const F *)arg)(begin, end);
+}
+
+// the same, for a function object f(b, e)
+template <class F>
+inline void gt_parallel_for(int begin, int end, int grain, const F &f) {
+  gt_parallel_for(begin, end, grain, gt_parallel_call<F>, (void *)&f);
+}
+
+#endif